@@ -3,310 +3,5863 @@
 #include <stdexcept>
 #include <vector>
 #include <cassert>
+#include <memory>
+#include <new>
+#include <limits>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <iterator>
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <string>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <span>
+#include <barrier>
+#include <queue>
+#include <list>
+#include <set>
+#include <numeric>
+#include <optional>
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+#include <filesystem>
+#include <coroutine>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define LEFTIST_TREE_HAS_MMAP 1
+#else
+#define LEFTIST_TREE_HAS_MMAP 0
+#endif
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#define LEFTIST_TREE_HAS_PERF_EVENTS 1
+#else
+#define LEFTIST_TREE_HAS_PERF_EVENTS 0
+#endif
 
 using namespace std;
 
+// Build with -DLEFTIST_TREE_STATS=1 to collect hot-path counters. They are kept
+// per thread, so the fast path never touches an atomic; with the switch off
+// every hook below compiles away.
+#ifndef LEFTIST_TREE_STATS
+#define LEFTIST_TREE_STATS 0
+#endif
+
+struct LeftistTreeStats {
+    static constexpr int kSpineBuckets = 2 * numeric_limits<size_t>::digits + 1;
+    static constexpr int kLatencyBuckets = 40;         // Bucket b holds samples in [2^b, 2^(b+1)) ns
+    static constexpr uint64_t kLatencySampleEvery = 1024; // Time one operation in this many
+
+    enum Op { Insert, ExtractMin, MergeWith, OpCount };
+
+    uint64_t merges = 0;
+    uint64_t mergePathLength[kSpineBuckets] = {}; // Histogram of merged right-spine lengths
+    uint64_t childSwaps = 0;
+    uint64_t nodeAllocations = 0;
+    uint64_t nodeFrees = 0; // Nodes handed back one by one; bulk releases are not seen
+    int64_t liveNodes = 0;  // Allocations minus frees on this thread
+    int64_t peakLiveNodes = 0;
+    uint64_t operations = 0;
+    uint64_t latency[OpCount][kLatencyBuckets] = {};
+
+    void recordMerge(int pathLength, uint64_t swaps) {
+        ++merges;
+        ++mergePathLength[min(pathLength, kSpineBuckets - 1)];
+        childSwaps += swaps;
+    }
+
+    void recordAllocations(size_t count) {
+        nodeAllocations += count;
+        liveNodes += static_cast<int64_t>(count);
+        peakLiveNodes = max(peakLiveNodes, liveNodes);
+    }
+
+    void recordFrees(size_t count) {
+        nodeFrees += count;
+        liveNodes -= static_cast<int64_t>(count);
+    }
+
+    void recordLatency(Op op, uint64_t nanoseconds) {
+        int bucket = 0;
+        while (bucket + 1 < kLatencyBuckets && (nanoseconds >> (bucket + 1)) != 0) {
+            ++bucket;
+        }
+        ++latency[op][bucket];
+    }
+
+    void print(ostream& out) const {
+        static const char* opNames[OpCount] = {"insert", "extractMin", "mergeWith"};
+        out << "merges: " << merges << ", child swaps: " << childSwaps << endl;
+        out << "merge path length histogram:";
+        for (int length = 0; length < kSpineBuckets; ++length) {
+            if (mergePathLength[length]) out << " " << length << ":" << mergePathLength[length];
+        }
+        out << endl;
+        out << "node allocations: " << nodeAllocations << ", frees: " << nodeFrees
+            << ", peak live: " << peakLiveNodes << endl;
+        for (int op = 0; op < OpCount; ++op) {
+            out << opNames[op] << " latency samples (ns bucket:count):";
+            for (int bucket = 0; bucket < kLatencyBuckets; ++bucket) {
+                if (latency[op][bucket]) out << " " << (uint64_t(1) << bucket) << ":" << latency[op][bucket];
+            }
+            out << endl;
+        }
+    }
+};
+
+// Counters of the calling thread
+inline LeftistTreeStats& leftistTreeStats() {
+    thread_local LeftistTreeStats stats;
+    return stats;
+}
+
+inline void resetLeftistTreeStats() {
+    leftistTreeStats() = LeftistTreeStats();
+}
+
+// Times every kLatencySampleEvery-th operation of the calling thread. Empty and
+// free when stats are disabled.
+class SampledOpTimer {
+#if LEFTIST_TREE_STATS
+private:
+    LeftistTreeStats::Op op;
+    bool sampled;
+    chrono::steady_clock::time_point start;
+
+public:
+    explicit SampledOpTimer(LeftistTreeStats::Op o)
+        : op(o), sampled(++leftistTreeStats().operations % LeftistTreeStats::kLatencySampleEvery == 0) {
+        if (sampled) start = chrono::steady_clock::now();
+    }
+
+    ~SampledOpTimer() {
+        if (sampled) {
+            auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start);
+            leftistTreeStats().recordLatency(op, static_cast<uint64_t>(elapsed.count()));
+        }
+    }
+#else
+public:
+    explicit SampledOpTimer(LeftistTreeStats::Op) {}
+#endif
+};
+
+// Parent link, only stored by nodes of addressable trees
+template <typename NodeT, bool HasParent>
+struct NodeParent {
+    void setParent(NodeT*) {}
+};
+
+template <typename NodeT>
+struct NodeParent<NodeT, true> {
+    NodeT *parent = nullptr; // Pointer to the parent, null for a root
+
+    void setParent(NodeT* node) {
+        parent = node;
+    }
+};
+
+// Balance policies for LeftistTree, i.e. which rank keeps the right spines short.
+// HeightBiased: rank is the npl, O(log N) worst case per operation.
+struct HeightBiased {};
+// WeightBiased: rank is the subtree size, which is known on the way down, so a
+// merge swaps children top-down in a single pass with no path stack.
+// Not available for addressable trees.
+struct WeightBiased {};
+// Skew: no rank at all; a merge swaps the children of every node on its path.
+// O(log N) amortized only, with a smaller node when T is 8-byte aligned.
+// Not available for addressable trees.
+struct Skew {};
+
+// Rank stored by nodes under a balance policy
+template <typename Balance>
+struct NodeRank;
+
+template <>
+struct NodeRank<HeightBiased> {
+    int npl = 0; // Null Path Length - length of the shortest path from this node to a null child
+};
+
+template <>
+struct NodeRank<WeightBiased> {
+    size_t weight = 1; // Number of nodes in this subtree
+};
+
+template <>
+struct NodeRank<Skew> {};
+
+// Opt-in for the branchless height-biased merge: keys whose comparison is cheap
+// and free of side effects, so it can be evaluated unconditionally and nodes
+// picked with selects instead of branches. Off by default: measured here the
+// selects serialize the spine walk on its loads, which branch prediction would
+// otherwise overlap, and merges got slower (see benchmarkBranchlessMerge).
+// Enable per key type with BranchlessLess, or specialize for a comparator;
+// keys must be trivially copyable and default-constructible.
+template <typename T, typename Compare>
+struct BranchlessMerge : false_type {};
+
+// less<T> that selects the branchless merge for arithmetic keys
+template <typename T>
+struct BranchlessLess : less<T> {};
+
+template <typename T>
+struct BranchlessMerge<T, BranchlessLess<T>> : bool_constant<is_arithmetic_v<T>> {};
+
 // Node structure for the Leftist Tree
-struct Node {
-    int key;     // The value stored in the node
-    int npl;     // Null Path Length - length of the shortest path from this node to a null child
+// For a small trivially-copyable T (e.g. int) this is the compact 24-byte layout:
+// npl and key share the first 8 bytes, followed by the two child pointers.
+// Addressable nodes additionally carry a parent pointer.
+template <typename T, bool Addressable = false, typename Balance = HeightBiased>
+struct Node : NodeParent<Node<T, Addressable, Balance>, Addressable>, NodeRank<Balance> {
+    T key;       // The value stored in the node
     Node *left;  // Pointer to the left child
     Node *right; // Pointer to the right child
 
-    Node(int k) : key(k), npl(0), left(nullptr), right(nullptr) {}
+    template <typename... Args>
+    explicit Node(in_place_t, Args&&... args)
+        : key(std::forward<Args>(args)...), left(nullptr), right(nullptr) {}
+};
+
+// Slab allocator for tree nodes. Nodes are carved out of fixed-size slabs and
+// recycled through an intrusive free list threaded through Node::right, so
+// steady-state insert/extractMin never reach the system allocator.
+// A pool may be shared by several trees (it is not thread-safe); memory is only
+// returned to the system when the pool itself is destroyed.
+template <typename NodeT, typename Allocator = allocator<NodeT>>
+class NodePool {
+public:
+    using NodeType = NodeT;
+
+private:
+    using NodeAllocator = typename allocator_traits<Allocator>::template rebind_alloc<NodeType>;
+    using NodeAllocTraits = allocator_traits<NodeAllocator>;
+
+    // Regular slabs start small and double up to kMaxSlabNodes, so that pools of
+    // small, frequently melded trees don't each pin a large slab.
+    static constexpr size_t kMinSlabNodes = 16;
+    static constexpr size_t kMaxSlabNodes = 1024;
+
+    struct Slab {
+        NodeType *nodes;
+        size_t count;
+    };
+
+    NodeAllocator alloc;     // Supplies raw slab storage
+    vector<Slab> slabs;      // Raw storage blocks owned by this pool
+    NodeType *freeHead;      // Recycled nodes, linked through Node::right
+    NodeType *freeTail;
+    NodeType *bumpCursor;    // Next never-used node in the newest slab
+    NodeType *bumpEnd;
+    // Pools whose nodes were melded into trees drawing from this pool. Those nodes
+    // may end up on our free list, so their storage has to live as long as we do.
+    vector<shared_ptr<NodePool>> retained;
+
+    void pushFree(NodeType* node) {
+        node->right = freeHead;
+        if (freeHead == nullptr) {
+            freeTail = node;
+        }
+        freeHead = node;
+    }
+
+    size_t nextSlabNodes() const {
+        return slabs.empty() ? kMinSlabNodes : min(slabs.back().count * 2, kMaxSlabNodes);
+    }
+
+    void addSlab(size_t count) {
+        NodeType* slab = NodeAllocTraits::allocate(alloc, count);
+        slabs.push_back(Slab{slab, count});
+        bumpCursor = slab;
+        bumpEnd = slab + count;
+    }
+
+public:
+    explicit NodePool(const Allocator& allocator = Allocator())
+        : alloc(allocator), freeHead(nullptr), freeTail(nullptr), bumpCursor(nullptr), bumpEnd(nullptr) {}
+
+    // Releases raw storage only; owners destroy live values beforehand
+    ~NodePool() {
+        for (const Slab& slab : slabs) {
+            NodeAllocTraits::deallocate(alloc, slab.nodes, slab.count);
+        }
+    }
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    // Get a node from the free list, falling back to the current slab, and
+    // construct its value in place from args
+    template <typename... Args>
+    NodeType* allocate(Args&&... args) {
+        NodeType* node;
+        if (freeHead != nullptr) {
+            node = freeHead;
+            freeHead = node->right;
+            if (freeHead == nullptr) {
+                freeTail = nullptr;
+            }
+        } else {
+            if (bumpCursor == bumpEnd) {
+                addSlab(nextSlabNodes());
+            }
+            node = bumpCursor++;
+        }
+        try {
+            new (node) NodeType(in_place, std::forward<Args>(args)...);
+        } catch (...) {
+            pushFree(node);
+            throw;
+        }
+        if constexpr (LEFTIST_TREE_STATS) leftistTreeStats().recordAllocations(1);
+        return node;
+    }
+
+    // Put count nodes on the free list ahead of time, in one slab if a new one is
+    // needed, so the next count allocations don't reach the system allocator
+    void reserve(size_t count) {
+        NodeType* block = allocateBlock(count);
+        for (size_t i = count; i > 0; --i) {
+            pushFree(block + i - 1);
+        }
+        if constexpr (LEFTIST_TREE_STATS) leftistTreeStats().recordFrees(count);
+    }
+
+    // Reserve count contiguous, unconstructed nodes. Construct each with
+    // construct(), and hand back any that end up unused with release().
+    NodeType* allocateBlock(size_t count) {
+        if (static_cast<size_t>(bumpEnd - bumpCursor) < count) {
+            // Keep the old slab's tail usable before starting a new slab
+            for (NodeType* node = bumpCursor; node != bumpEnd; ++node) {
+                pushFree(node);
+            }
+            addSlab(max(count, nextSlabNodes()));
+        }
+        NodeType* block = bumpCursor;
+        bumpCursor += count;
+        if constexpr (LEFTIST_TREE_STATS) leftistTreeStats().recordAllocations(count);
+        return block;
+    }
+
+    template <typename... Args>
+    static NodeType* construct(NodeType* node, Args&&... args) {
+        return new (node) NodeType(in_place, std::forward<Args>(args)...);
+    }
+
+    // Return storage whose value was never constructed
+    void release(NodeType* node) {
+        pushFree(node);
+        if constexpr (LEFTIST_TREE_STATS) leftistTreeStats().recordFrees(1);
+    }
+
+    // Return a chain of count nodes, linked through right, whose values were
+    // already destroyed. Splices the whole chain onto the free list in O(1).
+    void releaseChain(NodeType* head, NodeType* tail, size_t count) {
+        if (head == nullptr) {
+            return;
+        }
+        if constexpr (LEFTIST_TREE_STATS) leftistTreeStats().recordFrees(count);
+        tail->right = freeHead;
+        if (freeHead == nullptr) {
+            freeTail = tail;
+        }
+        freeHead = head;
+    }
+
+    static void destroy(NodeType* node) {
+        node->~NodeType();
+    }
+
+    // Destroy the node's value and return the node to the free list.
+    // Its storage stays with the pool.
+    void deallocate(NodeType* node) {
+        node->~NodeType();
+        pushFree(node);
+        if constexpr (LEFTIST_TREE_STATS) leftistTreeStats().recordFrees(1);
+    }
+
+    // Slabs can change hands only if our allocator can free what other allocated
+    bool canAbsorb(const NodePool& other) const {
+        return alloc == other.alloc;
+    }
+
+    // Take over every slab, free node and retained pool of other, leaving it empty.
+    // Time Complexity: O(S + U), where S is the number of slabs in other and U the
+    // smaller of the two unused slab tails.
+    void absorb(NodePool& other) {
+        if (this == &other) {
+            return;
+        }
+        slabs.insert(slabs.end(), other.slabs.begin(), other.slabs.end());
+        other.slabs.clear();
+
+        if (other.freeHead != nullptr) {
+            other.freeTail->right = freeHead;
+            if (freeHead == nullptr) {
+                freeTail = other.freeTail;
+            }
+            freeHead = other.freeHead;
+        }
+        // Keep whichever unused slab tail is larger as the bump region
+        if (other.bumpEnd - other.bumpCursor > bumpEnd - bumpCursor) {
+            swap(bumpCursor, other.bumpCursor);
+            swap(bumpEnd, other.bumpEnd);
+        }
+        for (NodeType* node = other.bumpCursor; node != other.bumpEnd; ++node) {
+            pushFree(node);
+        }
+        other.freeHead = other.freeTail = nullptr;
+        other.bumpCursor = other.bumpEnd = nullptr;
+
+        for (shared_ptr<NodePool>& pool : other.retained) {
+            retain(pool);
+        }
+        other.retained.clear();
+    }
+
+    // Keep other alive for as long as this pool exists.
+    // Note: two pools that retain each other are never released.
+    void retain(const shared_ptr<NodePool>& other) {
+        if (other.get() == this || find(retained.begin(), retained.end(), other) != retained.end()) {
+            return;
+        }
+        retained.push_back(other);
+    }
+
+    template <typename ValueAllocator>
+    ValueAllocator getAllocator() const {
+        return ValueAllocator(alloc);
+    }
+
+    size_t slabCount() const {
+        return slabs.size();
+    }
 };
 
+template <typename T, typename Compare, typename Allocator>
+class LazyLeftistTree;
+
+template <typename T, typename Compare, typename Allocator>
+class DoubleEndedLeftistHeap;
+
+template <typename T, typename Compare, typename Allocator>
+class BoundedTopK;
+
+template <typename T>
+class CompactArena;
+
+// Min-heap ordered by Compare: the root holds the element x for which no other
+// element y satisfies comp(y, x).
+// Addressable trees keep parent pointers so that handles returned by insert can
+// be passed to decreaseKey and erase. Balance picks the rank policy (see
+// HeightBiased, WeightBiased and Skew); the public API is the same under each.
+template <typename T, typename Compare = less<T>, typename Allocator = allocator<T>, bool Addressable = false,
+          typename Balance = HeightBiased>
 class LeftistTree {
+private:
+    using Node = ::Node<T, Addressable, Balance>;
+
+    static constexpr bool kHeightBiased = is_same<Balance, HeightBiased>::value;
+    static constexpr bool kWeightBiased = is_same<Balance, WeightBiased>::value;
+    static constexpr bool kBranchless = kHeightBiased && BranchlessMerge<T, Compare>::value;
+    static_assert(!Addressable || kHeightBiased, "Handles need a height-biased LeftistTree");
+    static_assert(!kBranchless || (is_trivially_copyable_v<T> && is_default_constructible_v<T>),
+                  "The branchless merge needs trivially copyable, default-constructible keys");
+
+    template <typename, typename, typename>
+    friend class LazyLeftistTree;
+
+    template <typename, typename, typename>
+    friend class DoubleEndedLeftistHeap;
+
+    template <typename, typename, typename>
+    friend class BoundedTopK;
+
+public:
+    using Pool = NodePool<Node, Allocator>;
+
+    // Stable reference to an element, valid until it is extracted or erased
+    // (also across mergeWith). Only addressable trees accept it back.
+    class Handle {
+    private:
+        Node *node;
+        friend class LeftistTree;
+        template <typename, typename, typename>
+        friend class DoubleEndedLeftistHeap;
+        explicit Handle(Node* n) : node(n) {}
+
+    public:
+        Handle() : node(nullptr) {}
+
+        const T& operator*() const {
+            return node->key;
+        }
+
+        const T* operator->() const {
+            return &node->key;
+        }
+
+        explicit operator bool() const {
+            return node != nullptr;
+        }
+
+        bool operator==(const Handle& other) const {
+            return node == other.node;
+        }
+
+        bool operator!=(const Handle& other) const {
+            return node != other.node;
+        }
+    };
+
 private:
     // The root node of the leftist tree.
     Node *root;
+    // Node storage, possibly shared with other trees.
+    shared_ptr<Pool> pool;
+    Compare comp;
+    // Number of keys, maintained by every operation (and moved by melds)
+    size_t count;
+
+    // Helper function to get NPL of a node (handles null)
+    static int getNPL(Node* node) {
+        if (node == nullptr) {
+            return -1;
+        }
+        return node->npl;
+    }
+
+    // Subtree size of a weight-biased node (handles null)
+    static size_t getWeight(Node* node) {
+        if (node == nullptr) {
+            return 0;
+        }
+        return node->weight;
+    }
+
+    // Stand-in for a missing child when reading npls without a null check
+    static inline const Node nullSentinel = [] {
+        Node sentinel(in_place);
+        sentinel.npl = -1;
+        sentinel.left = sentinel.right = nullptr;
+        return sentinel;
+    }();
+
+    // a if pick, else b, computed with a mask rather than a branch
+    template <typename P>
+    static P* selectNode(bool pick, P* a, P* b) {
+        uintptr_t mask = uintptr_t(0) - static_cast<uintptr_t>(pick);
+        return reinterpret_cast<P*>((reinterpret_cast<uintptr_t>(a) & mask) | (reinterpret_cast<uintptr_t>(b) & ~mask));
+    }
+
+    // getNPL without the branch: select the sentinel for null, then load
+    static int nplOrSentinel(const Node* node) {
+        return selectNode(node != nullptr, node, &nullSentinel)->npl;
+    }
+
+    // Helper function to swap children of a node
+    static void swapChildren(Node* node) {
+        if (node) {
+            std::swap(node->left, node->right);
+        }
+    }
+
+    // Upper bound on the merge path: each right spine has at most log2(N + 1) nodes.
+    static constexpr int kMaxMergePath = 2 * numeric_limits<size_t>::digits;
+
+    // Merges two leftist heaps h1 and h2, returns the root of the merged heap
+    // Time Complexity: O(log N), where N is the total number of nodes in both heaps.
+    // This is because the path we traverse during merging is always the right path,
+    // which has a maximum length proportional to the logarithm of the number of nodes.
+    // Space complexity for storing the tree itself: O(N)
+    // The height-biased merge is iterative: the first pass walks both right spines,
+    // always splicing in the smaller root, and records the merged path on a
+    // fixed-size stack; the second pass restores the leftist property bottom-up.
+    Node* merge(Node* h1, Node* h2) {
+        if constexpr (kBranchless) {
+            return mergeBranchless(h1, h2);
+        } else if constexpr (kHeightBiased) {
+            return mergeByHeight(h1, h2);
+        } else {
+            return mergeTopDown(h1, h2);
+        }
+    }
+
+    Node* mergeByHeight(Node* h1, Node* h2) {
+        if (h1 == nullptr || h2 == nullptr) {
+            Node* only = h1 ? h1 : h2;
+            if (only) only->setParent(nullptr);
+            return only;
+        }
+
+        if (comp(h2->key, h1->key)) {
+            std::swap(h1, h2);
+        }
+
+        Node* path[kMaxMergePath];
+        int depth = 0;
+        Node* mergedRoot = h1;
+        mergedRoot->setParent(nullptr);
+        while (true) {
+            path[depth++] = h1;
+            Node* next = h1->right;
+            if (next == nullptr) {
+                h1->right = h2;
+                h2->setParent(h1);
+                break;
+            }
+            if (comp(h2->key, next->key)) {
+                std::swap(next, h2);
+            }
+            h1->right = next;
+            next->setParent(h1);
+            h1 = next;
+        }
+
+        fixMergePath(path, depth);
+        return mergedRoot;
+    }
+
+    // mergeByHeight for BranchlessMerge keys. With random keys the min choice at
+    // every spine step and the child swap on the way back mispredict about half
+    // the time, so both are computed as data: the compare result selects the
+    // nodes, and missing children read npl -1 from a sentinel. Only the loop
+    // exit (end of a right spine) is still a branch.
+    Node* mergeBranchless(Node* h1, Node* h2) {
+        if (h1 == nullptr || h2 == nullptr) {
+            Node* only = h1 ? h1 : h2;
+            if (only) only->setParent(nullptr);
+            return only;
+        }
+
+        bool second = comp(h2->key, h1->key);
+        Node* mergedRoot = selectNode(second, h2, h1);
+        h2 = selectNode(second, h1, h2);
+        h1 = mergedRoot;
+
+        Node* path[kMaxMergePath];
+        int depth = 0;
+        mergedRoot->setParent(nullptr);
+        while (true) {
+            path[depth++] = h1;
+            Node* next = h1->right;
+            if (next == nullptr) {
+                h1->right = h2;
+                h2->setParent(h1);
+                break;
+            }
+            bool take = comp(h2->key, next->key);
+            Node* smaller = selectNode(take, h2, next);
+            h2 = selectNode(take, next, h2);
+            h1->right = smaller;
+            smaller->setParent(h1);
+            h1 = smaller;
+        }
+
+        [[maybe_unused]] int pathLength = depth;
+        [[maybe_unused]] uint64_t swaps = 0;
+        while (depth > 0) {
+            Node* node = path[--depth];
+            Node* left = node->left;
+            Node* right = node->right;
+            int leftNPL = nplOrSentinel(left);
+            int rightNPL = nplOrSentinel(right);
+            bool swapped = leftNPL < rightNPL;
+            node->left = selectNode(swapped, right, left);
+            node->right = selectNode(swapped, left, right);
+            node->npl = min(leftNPL, rightNPL) + 1;
+            if constexpr (LEFTIST_TREE_STATS) swaps += swapped;
+        }
+        if constexpr (LEFTIST_TREE_STATS) leftistTreeStats().recordMerge(pathLength, swaps);
+        return mergedRoot;
+    }
+
+    // Weight-biased and skew merge. Weight-biased: the smaller root takes on the
+    // other heap's weight, and since the weight its new right subtree will have is
+    // known up front, the child swap is decided before descending. Skew: the swap
+    // is unconditional. Either way one pass, nothing to fix afterwards.
+    Node* mergeTopDown(Node* h1, Node* h2) {
+        Node* mergedRoot = nullptr;
+        Node** link = &mergedRoot;
+        Node* parent = nullptr;
+        [[maybe_unused]] int pathLength = 0;
+        [[maybe_unused]] uint64_t swaps = 0;
+        while (h1 != nullptr && h2 != nullptr) {
+            if (comp(h2->key, h1->key)) {
+                std::swap(h1, h2);
+            }
+            *link = h1;
+            h1->setParent(parent);
+            Node* rest = h1->right;
+            bool keepLeft = false;
+            if constexpr (kWeightBiased) {
+                size_t mergedWeight = getWeight(rest) + h2->weight;
+                h1->weight += h2->weight;
+                keepLeft = getWeight(h1->left) >= mergedWeight;
+            }
+            if (keepLeft) {
+                link = &h1->right;
+            } else {
+                h1->right = h1->left;
+                link = &h1->left;
+                if constexpr (LEFTIST_TREE_STATS) ++swaps;
+            }
+            parent = h1;
+            h1 = rest;
+            if constexpr (LEFTIST_TREE_STATS) ++pathLength;
+        }
+        Node* tail = h1 ? h1 : h2;
+        *link = tail;
+        if (tail) tail->setParent(parent);
+        if constexpr (LEFTIST_TREE_STATS) {
+            if (pathLength > 0) leftistTreeStats().recordMerge(pathLength, swaps);
+        }
+        return mergedRoot;
+    }
+
+    // Second pass of a merge: restore the leftist property bottom-up along the
+    // right path the first pass built
+    void fixMergePath(Node* const* path, int depth) {
+        [[maybe_unused]] int pathLength = depth;
+        [[maybe_unused]] uint64_t swaps = 0;
+        while (depth > 0) {
+            Node* node = path[--depth];
+            if (getNPL(node->left) < getNPL(node->right)) {
+                swapChildren(node);
+                if constexpr (LEFTIST_TREE_STATS) ++swaps;
+            }
+            node->npl = getNPL(node->right) + 1;
+        }
+        if constexpr (LEFTIST_TREE_STATS) leftistTreeStats().recordMerge(pathLength, swaps);
+    }
+
+    // Meld h1, h2 and the childless node single in one pass: walk the merge of h1
+    // and h2 until single is no larger than both remaining heads, then single
+    // adopts those two heads as its children and the walk stops there
+    Node* mergeWithSingle(Node* h1, Node* h2, Node* single) {
+        if constexpr (kHeightBiased) {
+            return mergeWithSingleByHeight(h1, h2, single);
+        } else {
+            // Ranks (or skew swaps) below single's final position depend on both
+            // heads, so there is no early stop; meld the children, then single
+            return mergeTopDown(mergeTopDown(h1, h2), single);
+        }
+    }
+
+    Node* mergeWithSingleByHeight(Node* h1, Node* h2, Node* single) {
+        Node* path[kMaxMergePath + 1];
+        int depth = 0;
+        Node* mergedRoot = nullptr;
+        Node* tail = nullptr;
+        auto attach = [&](Node* node) {
+            if (tail == nullptr) {
+                mergedRoot = node;
+                node->setParent(nullptr);
+            } else {
+                tail->right = node;
+                node->setParent(tail);
+            }
+            path[depth++] = node;
+            tail = node;
+        };
+        while (true) {
+            if (h1 == nullptr || (h2 != nullptr && comp(h2->key, h1->key))) {
+                std::swap(h1, h2);
+            }
+            if (h1 == nullptr || !comp(h1->key, single->key)) {
+                single->left = h1;
+                single->right = h2;
+                if (h1) h1->setParent(single);
+                if (h2) h2->setParent(single);
+                attach(single);
+                break;
+            }
+            Node* next = h1->right;
+            attach(h1);
+            h1 = next;
+        }
+
+        fixMergePath(path, depth);
+        return mergedRoot;
+    }
+
+    // Helper for destructor: delete nodes without recursion. Left children are
+    // rotated onto the right chain so every node is visited with O(1) extra space.
+    void destroyTree(Node* node) {
+        while (node) {
+            if (node->left) {
+                Node* left = node->left;
+                node->left = left->right;
+                left->right = node;
+                node = left;
+            } else {
+                Node* right = node->right;
+                pool->deallocate(node);
+                node = right;
+            }
+        }
+    }
+
+    // Restores npl and child order on the path from node up to the root after
+    // one of node's subtrees changed. Stops as soon as an npl stays the same; the
+    // npl values along a changing path strictly increase, so this is O(log N).
+    void fixUpward(Node* node) {
+        while (node) {
+            if (getNPL(node->left) < getNPL(node->right)) {
+                swapChildren(node);
+            }
+            int npl = getNPL(node->right) + 1;
+            if (npl == node->npl) {
+                return;
+            }
+            node->npl = npl;
+            node = node->parent;
+        }
+    }
+
+    // Replaces node by subtree in node's parent (or at the root) and repairs the
+    // leftist property above it
+    void replaceSubtree(Node* node, Node* subtree) {
+        Node* parent = node->parent;
+        if (subtree) subtree->setParent(parent);
+        if (parent == nullptr) {
+            root = subtree;
+            return;
+        }
+        if (parent->left == node) {
+            parent->left = subtree;
+        } else {
+            parent->right = subtree;
+        }
+        fixUpward(parent);
+    }
+
+    // Melds a list of heaps by merging neighbours pairwise, round after round,
+    // which is the same order as a FIFO queue of heaps. Consumes roots.
+    // Time Complexity: O(K) for K singleton heaps, since round r performs K / 2^r
+    // merges of heaps with O(r) long right spines.
+    template <typename Roots>
+    Node* mergePairwise(Roots& roots) {
+        size_t remaining = roots.size();
+        if (remaining == 0) {
+            return nullptr;
+        }
+        while (remaining > 1) {
+            size_t out = 0;
+            for (size_t i = 0; i + 1 < remaining; i += 2) {
+                roots[out++] = merge(roots[i], roots[i + 1]);
+            }
+            if (remaining % 2 == 1) {
+                roots[out++] = roots[remaining - 1];
+            }
+            remaining = out;
+        }
+        return roots[0];
+    }
+
+    // Builds a heap from n values into one contiguous block of nodes
+    template <typename ForwardIt>
+    Node* buildHeap(ForwardIt first, size_t n) {
+        if (n == 0) {
+            return nullptr;
+        }
+        Node* block = pool->allocateBlock(n);
+        vector<Node*> roots;
+        roots.reserve(n);
+        try {
+            for (size_t i = 0; i < n; ++i, ++first) {
+                roots.push_back(Pool::construct(block + i, *first));
+            }
+        } catch (...) {
+            for (Node* node : roots) {
+                pool->deallocate(node);
+            }
+            for (size_t i = roots.size(); i < n; ++i) {
+                pool->release(block + i);
+            }
+            throw;
+        }
+        return mergePairwise(roots);
+    }
+
+    // If nobody else can reach our pool and values need no destructor,
+    // dropping the pool releases every slab at once. Nodes carved from
+    // retained pools go with them when their last owner lets go.
+    bool releasesInBulk() const {
+        return is_trivially_destructible<T>::value && pool.use_count() == 1;
+    }
+
+    // The other tree's nodes are about to move here, so their storage must outlive
+    // our pool. Take its slabs outright when nobody else uses them.
+    void adoptPoolOf(LeftistTree& otherTree) {
+        if (otherTree.pool == pool) {
+            return;
+        }
+        if (otherTree.pool.use_count() == 1 && pool->canAbsorb(*otherTree.pool)) {
+            pool->absorb(*otherTree.pool);
+        } else {
+            pool->retain(otherTree.pool);
+        }
+    }
+
+    // Start loading a node we are about to read. Prefetches never fault, so null
+    // needs no check.
+    static void prefetchNode(const Node* node) {
+#if defined(__GNUC__)
+        __builtin_prefetch(node);
+#else
+        (void)node;
+#endif
+    }
+
+    // Prefetch the two levels below node. The next pop merges node's children,
+    // whose lines went out one pop earlier as grandchildren, so reading them to
+    // reach the level below is usually a hit.
+    static void prefetchCandidates(const Node* node) {
+        for (const Node* child : {node->left, node->right}) {
+            if (child != nullptr) {
+                prefetchNode(child->left);
+                prefetchNode(child->right);
+            }
+        }
+    }
+
+    // Pop the root, then prefetch under the new root while the caller uses its key
+    void popRootPrefetching() {
+        Node* oldRoot = root;
+        root = merge(oldRoot->left, oldRoot->right);
+        pool->deallocate(oldRoot);
+        --count;
+        if (root != nullptr) {
+            prefetchCandidates(root);
+        }
+    }
+
+    // Helper for pretty printing the tree structure
+    void printTreeRecursive(Node* node, const string& prefix, bool isLeft) const {
+        if (node == nullptr) {
+            return;
+        }
+
+        cout << prefix;
+        cout << (isLeft ? "├──L:" : "└──R:");
+        if constexpr (kHeightBiased) {
+            cout << node->key << " (npl:" << node->npl << ")" << endl;
+        } else if constexpr (kWeightBiased) {
+            cout << node->key << " (weight:" << node->weight << ")" << endl;
+        } else {
+            cout << node->key << endl;
+        }
+
+        printTreeRecursive(node->left, prefix + (isLeft ? "│   " : "    "), true);
+        printTreeRecursive(node->right, prefix + (isLeft ? "│   " : "    "), false);
+    }
+
+
+public:
+    explicit LeftistTree(const Compare& compare = Compare(), const Allocator& alloc = Allocator())
+        : root(nullptr), pool(make_shared<Pool>(alloc)), comp(compare), count(0) {}
+
+    // Draw nodes from a pool shared with other trees. Trees that share a pool
+    // meld without any pool bookkeeping.
+    explicit LeftistTree(shared_ptr<Pool> sharedPool, const Compare& compare = Compare())
+        : root(nullptr), pool(std::move(sharedPool)), comp(compare), count(0) {}
+
+    // Build a heap from [first, last) in O(N) time instead of N inserts
+    template <typename InputIt, typename = typename iterator_traits<InputIt>::iterator_category>
+    LeftistTree(InputIt first, InputIt last, const Compare& compare = Compare(), const Allocator& alloc = Allocator())
+        : LeftistTree(compare, alloc) {
+        assign(first, last);
+    }
+
+    // Moves only transfer the root, so containers of trees relocate without
+    // touching nodes. The moved-from tree is left empty, drawing from the same
+    // pool, and stays fully usable; it keeps a copy of the comparator, so moves
+    // are noexcept only if copying and swapping Compare is.
+    static constexpr bool kNothrowMove = is_nothrow_copy_constructible_v<Compare> && is_nothrow_swappable_v<Compare>;
+
+    LeftistTree(LeftistTree&& other) noexcept(kNothrowMove)
+        : root(exchange(other.root, nullptr)), pool(other.pool), comp(other.comp), count(exchange(other.count, 0)) {}
+
+    LeftistTree& operator=(LeftistTree&& other) noexcept(kNothrowMove) {
+        if (this != &other) {
+            LeftistTree moved(std::move(other));
+            swap(moved);
+        }
+        return *this;
+    }
+
+    // Copies must be explicit, see clone()
+    LeftistTree(const LeftistTree&) = delete;
+    LeftistTree& operator=(const LeftistTree&) = delete;
+
+    ~LeftistTree() {
+        if (releasesInBulk()) {
+            return;
+        }
+        destroyTree(root);
+    }
+
+    void swap(LeftistTree& other) noexcept(is_nothrow_swappable_v<Compare>) {
+        std::swap(root, other.root);
+        std::swap(pool, other.pool);
+        std::swap(comp, other.comp);
+        std::swap(count, other.count);
+    }
+
+    // Move every node into one fresh contiguous block laid out breadth-first, so
+    // the top levels that each merge walks share cache lines and pages. The tree
+    // gets a pool of its own (the old one is dropped or, if shared, gets the old
+    // nodes back). Shape and keys are unchanged. Time Complexity: O(N)
+    void compact() {
+        static_assert(!Addressable, "compact moves nodes, which would invalidate handles");
+        if (root == nullptr) {
+            return;
+        }
+        vector<Node*> order;
+        order.reserve(count);
+        order.push_back(root);
+        for (size_t i = 0; i < order.size(); ++i) {
+            if (order[i]->left) order.push_back(order[i]->left);
+            if (order[i]->right) order.push_back(order[i]->right);
+        }
+
+        auto newPool = make_shared<Pool>(pool->template getAllocator<Allocator>());
+        size_t n = order.size();
+        Node* block = newPool->allocateBlock(n);
+        size_t built = 0;
+        try {
+            for (; built < n; ++built) {
+                Pool::construct(block + built, move_if_noexcept(order[built]->key));
+            }
+        } catch (...) {
+            for (size_t i = 0; i < n; ++i) {
+                if (i < built) {
+                    newPool->deallocate(block + i);
+                } else {
+                    newPool->release(block + i);
+                }
+            }
+            throw;
+        }
+        size_t next = 1;
+        for (size_t i = 0; i < n; ++i) {
+            static_cast<NodeRank<Balance>&>(block[i]) = static_cast<const NodeRank<Balance>&>(*order[i]);
+            if (order[i]->left) block[i].left = block + next++;
+            if (order[i]->right) block[i].right = block + next++;
+        }
+
+        if (!releasesInBulk()) {
+            for (Node* node : order) {
+                pool->deallocate(node);
+            }
+        }
+        pool = std::move(newPool);
+        root = block;
+    }
+
+    // Deep copy with the same shape, in a fresh pool with the same allocator. The
+    // nodes are copied in one preorder pass into a single contiguous block.
+    // Handles of this tree don't carry over.
+    LeftistTree clone() const {
+        LeftistTree copy(comp, pool->template getAllocator<Allocator>());
+        if (root == nullptr) {
+            return copy;
+        }
+        Node* block = copy.pool->allocateBlock(count);
+        size_t built = 0;
+        auto copyNode = [&](const Node* node, Node* parent) {
+            Node* copied = Pool::construct(block + built, node->key);
+            ++built;
+            static_cast<NodeRank<Balance>&>(*copied) = static_cast<const NodeRank<Balance>&>(*node);
+            copied->setParent(parent);
+            return copied;
+        };
+        try {
+            vector<pair<const Node*, Node*>> stack; // (original, its copy)
+            copy.root = copyNode(root, nullptr);
+            stack.emplace_back(root, copy.root);
+            while (!stack.empty()) {
+                auto [original, copied] = stack.back();
+                stack.pop_back();
+                if (original->right) {
+                    copied->right = copyNode(original->right, copied);
+                    stack.emplace_back(original->right, copied->right);
+                }
+                if (original->left) {
+                    copied->left = copyNode(original->left, copied);
+                    stack.emplace_back(original->left, copied->left);
+                }
+            }
+        } catch (...) {
+            for (size_t i = 0; i < count; ++i) {
+                if (i < built) {
+                    copy.pool->deallocate(block + i);
+                } else {
+                    copy.pool->release(block + i);
+                }
+            }
+            copy.root = nullptr;
+            throw;
+        }
+        copy.count = count;
+        return copy;
+    }
+
+    bool isEmpty() const {
+        return root == nullptr;
+    }
+
+    // Insert a new key into the tree
+    Handle insert(const T& key) {
+        return emplace(key);
+    }
+
+    Handle insert(T&& key) {
+        return emplace(std::move(key));
+    }
+
+    // Construct a new key in place from args
+    template <typename... Args>
+    Handle emplace(Args&&... args) {
+        SampledOpTimer timer(LeftistTreeStats::Insert);
+        Node* newNode = pool->allocate(std::forward<Args>(args)...);
+        root = merge(root, newNode);
+        ++count;
+        return Handle(newNode);
+    }
+
+    // Insert every key of batch with a single merge. The batch is sorted (skipped
+    // if it already is) and linked as a left-leaning chain in one contiguous
+    // block; a sorted chain is itself a leftist heap with every npl 0 and a
+    // one-node right spine, so melding it in walks only our right spine once.
+    // Time Complexity: O(B log B + log N). Handles are not returned.
+    void insertBatch(span<const T> batch) {
+        if (batch.empty()) {
+            return;
+        }
+        SampledOpTimer timer(LeftistTreeStats::Insert);
+        vector<T> sorted(batch.begin(), batch.end());
+        if (!is_sorted(sorted.begin(), sorted.end(), comp)) {
+            sort(sorted.begin(), sorted.end(), comp);
+        }
+        size_t n = sorted.size();
+        Node* block = pool->allocateBlock(n);
+        size_t built = 0;
+        try {
+            for (; built < n; ++built) {
+                Pool::construct(block + built, std::move(sorted[built]));
+            }
+        } catch (...) {
+            for (size_t i = 0; i < n; ++i) {
+                if (i < built) {
+                    pool->deallocate(block + i);
+                } else {
+                    pool->release(block + i);
+                }
+            }
+            throw;
+        }
+        for (size_t i = 0; i + 1 < n; ++i) {
+            block[i].left = block + i + 1;
+            block[i + 1].setParent(block + i);
+        }
+        if constexpr (kWeightBiased) {
+            for (size_t i = 0; i < n; ++i) block[i].weight = n - i;
+        }
+        root = merge(root, block);
+        count += n;
+    }
+
+    // Lower the key of the element behind handle to newKey. If heap order with
+    // the parent breaks, the element's subtree is cut off and merged back in.
+    // Time Complexity: O(log N)
+    void decreaseKey(Handle handle, T newKey) {
+        static_assert(Addressable, "decreaseKey requires an addressable LeftistTree");
+        Node* node = handle.node;
+        if (comp(node->key, newKey)) {
+            throw invalid_argument("New key is greater than current key!");
+        }
+        node->key = std::move(newKey);
+        if (node->parent == nullptr || !comp(node->key, node->parent->key)) {
+            return;
+        }
+        replaceSubtree(node, nullptr);
+        root = merge(root, node);
+    }
+
+    // Remove the element behind handle from the heap, wherever it is.
+    // Time Complexity: O(log N)
+    void erase(Handle handle) {
+        static_assert(Addressable, "erase requires an addressable LeftistTree");
+        Node* node = handle.node;
+        replaceSubtree(node, merge(node->left, node->right));
+        pool->deallocate(node);
+        --count;
+    }
+
+    // Replace the contents with the values in [first, last), built bottom-up
+    // Time Complexity: O(N)
+    template <typename InputIt, typename = typename iterator_traits<InputIt>::iterator_category>
+    void assign(InputIt first, InputIt last) {
+        clear();
+        using Category = typename iterator_traits<InputIt>::iterator_category;
+        if constexpr (is_base_of<forward_iterator_tag, Category>::value) {
+            size_t n = static_cast<size_t>(distance(first, last));
+            root = buildHeap(first, n);
+            count = n;
+        } else {
+            // Single-pass input: stage the values so the node block can be sized up front
+            vector<T> staged(first, last);
+            root = buildHeap(make_move_iterator(staged.begin()), staged.size());
+            count = staged.size();
+        }
+    }
+
+    // Remove every key
+    void clear() {
+        destroyTree(root);
+        root = nullptr;
+        count = 0;
+    }
+
+    // Number of keys in the tree. O(1)
+    size_t size() const {
+        return count;
+    }
+
+    // npl of the root, -1 for an empty tree. O(1)
+    int rootNPL() const {
+        static_assert(kHeightBiased, "Only height-biased nodes keep an npl");
+        return getNPL(root);
+    }
+
+    // Number of nodes on the root's right spine, i.e. the nodes the next merge
+    // into this tree walks at most; at most log2(size() + 1) unless skew. O(1)
+    // when height-biased, a walk down the spine otherwise.
+    size_t rightSpineLength() const {
+        if constexpr (kHeightBiased) {
+            return static_cast<size_t>(getNPL(root) + 1);
+        } else {
+            size_t length = 0;
+            for (const Node* node = root; node != nullptr; node = node->right) ++length;
+            return length;
+        }
+    }
+
+    // Get the minimum key (root key) without removing it
+    const T& getMin() const {
+        if (isEmpty()) {
+            throw runtime_error("Heap is empty!");
+        }
+        return root->key;
+    }
+
+    // Remove and return the minimum key; the value is moved out, never copied
+    T extractMin() {
+        if (isEmpty()) {
+            throw runtime_error("Heap is empty! Cannot extract min.");
+        }
+        SampledOpTimer timer(LeftistTreeStats::ExtractMin);
+
+        T minKey = std::move(root->key);
+        Node* oldRoot = root;
+        root = merge(root->left, root->right);
+        pool->deallocate(oldRoot);
+        --count;
+        return minKey;
+    }
+
+    // Pop the minimum and insert key, reusing the root node: no allocation, and at
+    // most one merge pass, which ends where key fits (at once if key is no larger
+    // than the root's children). With Addressable, the old minimum's handle now
+    // refers to key.
+    T replaceTop(T key) {
+        if (isEmpty()) {
+            throw runtime_error("Heap is empty! Cannot replace top.");
+        }
+        Node* node = root;
+        T minKey = std::move(node->key);
+        node->key = std::move(key);
+        Node* left = node->left;
+        Node* right = node->right;
+        node->left = nullptr;
+        node->right = nullptr;
+        static_cast<NodeRank<Balance>&>(*node) = NodeRank<Balance>();
+        root = mergeWithSingle(left, right, node);
+        return minKey;
+    }
+
+    // Insert key, then pop the minimum. A key no larger than the minimum is
+    // handed straight back without touching the heap; otherwise this is replaceTop.
+    T pushPop(T key) {
+        if (isEmpty() || !comp(root->key, key)) {
+            return key;
+        }
+        return replaceTop(std::move(key));
+    }
+
+    // Pop up to k smallest keys in ascending order into out. Freed nodes go back to
+    // the pool together at the end. Returns the number of keys written, which is
+    // less than k only if the heap ran empty (no exception is thrown). If writing
+    // to out throws, the keys popped so far are gone and the rest stay in the
+    // tree; size() and the pool are kept consistent either way.
+    template <typename OutputIt>
+    size_t extractMinBatch(size_t k, OutputIt out) {
+        Node *freedHead = nullptr, *freedTail = nullptr;
+        size_t extracted = 0;
+        try {
+            while (extracted < k && root != nullptr) {
+                Node* oldRoot = root;
+                *out = std::move(oldRoot->key);
+                root = merge(oldRoot->left, oldRoot->right);
+                Pool::destroy(oldRoot);
+                oldRoot->right = freedHead;
+                freedHead = oldRoot;
+                if (freedTail == nullptr) {
+                    freedTail = oldRoot;
+                }
+                --count;
+                ++extracted;
+                ++out;
+            }
+        } catch (...) {
+            pool->releaseChain(freedHead, freedTail, extracted);
+            throw;
+        }
+        pool->releaseChain(freedHead, freedTail, extracted);
+        return extracted;
+    }
+
+    // Pop every key in ascending order into out, leaving the heap empty
+    template <typename OutputIt>
+    size_t drainSorted(OutputIt out) {
+        return extractMinBatch(numeric_limits<size_t>::max(), out);
+    }
+
+    // Single-pass range over the keys in ascending order. Dereferencing gives the
+    // current minimum (which may be moved from); advancing pops it. A loop can stop
+    // early: the key it stopped at and everything after it stay in the tree.
+    class SortedDrain {
+    public:
+        class iterator {
+        public:
+            using iterator_concept = input_iterator_tag;
+            using iterator_category = input_iterator_tag;
+            using value_type = T;
+            using difference_type = ptrdiff_t;
+            using reference = T&;
+
+            iterator() : tree(nullptr) {}
+
+            T& operator*() const {
+                return tree->root->key;
+            }
+
+            iterator& operator++() {
+                tree->popRootPrefetching();
+                return *this;
+            }
+
+            void operator++(int) {
+                ++*this;
+            }
+
+            bool operator==(default_sentinel_t) const {
+                return tree == nullptr || tree->root == nullptr;
+            }
+
+        private:
+            friend class SortedDrain;
+
+            explicit iterator(LeftistTree* owner) : tree(owner) {}
+
+            LeftistTree* tree;
+        };
+
+        iterator begin() {
+            if (tree->root != nullptr) {
+                prefetchCandidates(tree->root);
+            }
+            return iterator(tree);
+        }
+
+        default_sentinel_t end() const {
+            return default_sentinel;
+        }
+
+    private:
+        friend class LeftistTree;
+
+        explicit SortedDrain(LeftistTree& owner) : tree(&owner) {}
+
+        LeftistTree* tree;
+    };
+
+    // for (T& key : tree.drained()) yields and pops the keys smallest first
+    SortedDrain drained() {
+        return SortedDrain(*this);
+    }
+
+    // Public interface to merge another LeftistTree into this one
+    void mergeWith(LeftistTree& otherTree) {
+        if (this == &otherTree) {
+            return;
+        }
+        SampledOpTimer timer(LeftistTreeStats::MergeWith);
+        adoptPoolOf(otherTree);
+        root = merge(this->root, otherTree.root);
+        otherTree.root = nullptr;
+        count += otherTree.count;
+        otherTree.count = 0;
+    }
+
+    // Meld every tree in trees into trees[0], leaving the others empty. The heaps
+    // are combined by a balanced pairwise reduction: round r melds pairs of
+    // heaps 2^r apart, and the independent pairs of a round are spread over up
+    // to threads workers (the caller included), so K heaps take log2(K)
+    // parallel rounds instead of K serial melds. The workers are std::threads
+    // started for this call and joined before it returns; there is no pool kept
+    // between calls, so this pays off for large reductions only. Pool bookkeeping
+    // is done serially up front. Trees must use the same comparator and null
+    // entries are skipped.
+    static void meldAll(span<LeftistTree*> trees, unsigned threads = thread::hardware_concurrency()) {
+        if (trees.empty() || trees[0] == nullptr) {
+            return;
+        }
+        LeftistTree& target = *trees[0];
+        vector<Node*> roots;
+        roots.reserve(trees.size());
+        for (LeftistTree* tree : trees) {
+            if (tree == nullptr || tree->root == nullptr) {
+                continue;
+            }
+            if (tree != &target) {
+                target.adoptPoolOf(*tree);
+            }
+            roots.push_back(tree->root);
+            tree->root = nullptr;
+            if (tree != &target) {
+                target.count += tree->count;
+                tree->count = 0;
+            }
+        }
+        size_t heapCount = roots.size();
+        size_t workers = min<size_t>(max(1u, threads), heapCount / 2);
+        if (workers <= 1) {
+            target.root = target.mergePairwise(roots);
+            return;
+        }
+
+        size_t stride = 1;
+        atomic<size_t> nextPair(0);
+        barrier roundDone(static_cast<ptrdiff_t>(workers), [&]() noexcept {
+            stride *= 2;
+            nextPair.store(0, memory_order_relaxed);
+        });
+        auto work = [&] {
+            while (stride < heapCount) {
+                size_t pairs = (heapCount - stride + 2 * stride - 1) / (2 * stride);
+                for (size_t pair; (pair = nextPair.fetch_add(1, memory_order_relaxed)) < pairs;) {
+                    size_t i = pair * 2 * stride;
+                    roots[i] = target.merge(roots[i], roots[i + stride]);
+                }
+                roundDone.arrive_and_wait();
+            }
+        };
+        vector<thread> helpers;
+        for (size_t i = 1; i < workers; ++i) {
+            helpers.emplace_back(work);
+        }
+        work();
+        for (thread& worker : helpers) {
+            worker.join();
+        }
+        target.root = roots[0];
+    }
+
+    const shared_ptr<Pool>& getPool() const {
+        return pool;
+    }
+
+    // Write the heap to path in the index-based image format, keeping its shape.
+    // Restart with CompactLeftistTree<T, Compare>::mapImage, which uses the file
+    // in place instead of re-inserting every key.
+    void saveImage(const string& path) const {
+        static_assert(is_trivially_copyable<T>::value, "Heap images store keys bytewise");
+        static_assert(kHeightBiased, "Heap images use the height-biased layout");
+        using Arena = CompactArena<T>;
+        using Index = typename Arena::Index;
+        if (count >= Arena::kNull) {
+            throw length_error("Heap is too large for an image!");
+        }
+        Arena image;
+        Index imageRoot = Arena::kNull;
+        if (root) {
+            vector<pair<const Node*, Index>> stack; // (node, its record)
+            imageRoot = image.allocate(root->key);
+            stack.emplace_back(root, imageRoot);
+            while (!stack.empty()) {
+                auto [node, record] = stack.back();
+                stack.pop_back();
+                image.nodes[record].npl = static_cast<uint8_t>(node->npl);
+                if (node->left) {
+                    Index child = image.allocate(node->left->key);
+                    image.nodes[record].left = child;
+                    stack.emplace_back(node->left, child);
+                }
+                if (node->right) {
+                    Index child = image.allocate(node->right->key);
+                    image.nodes[record].right = child;
+                    stack.emplace_back(node->right, child);
+                }
+            }
+        }
+        image.writeImage(path, imageRoot, count);
+    }
+
+    void printTree() const {
+        if (isEmpty()) {
+            cout << "Tree is empty." << endl;
+            return;
+        }
+        printTreeRecursive(root, "", false);
+    }
+};
+
+template <typename T, typename Compare = less<T>, typename Allocator = allocator<T>>
+using WeightBiasedLeftistTree = LeftistTree<T, Compare, Allocator, false, WeightBiased>;
+
+template <typename T, typename Compare = less<T>, typename Allocator = allocator<T>>
+using SkewHeap = LeftistTree<T, Compare, Allocator, false, Skew>;
+
+template <typename T, typename Compare = less<T>, typename Allocator = allocator<T>>
+using AddressableLeftistTree = LeftistTree<T, Compare, Allocator, true>;
+
+// Leftist heap with deferred merging. insert and mergeWith only queue heaps on a
+// pending list; the queue is consolidated by pairwise merging (linear in its
+// length) the next time the minimum is needed. This makes insert amortized O(1)
+// and meld O(1), for workloads that meld far more often than they pop.
+template <typename T, typename Compare = less<T>, typename Allocator = allocator<T>>
+class LazyLeftistTree {
+private:
+    using Tree = LeftistTree<T, Compare, Allocator>;
+    using Node = typename Tree::Node;
+
+    using Roots = vector<Node*, typename allocator_traits<Allocator>::template rebind_alloc<Node*>>;
+    using Segments = list<Roots, typename allocator_traits<Allocator>::template rebind_alloc<Roots>>;
+
+    Tree tree;     // Consolidated part of the heap
+    Roots pending; // Roots of heaps not yet merged into tree
+    // Pending lists taken over from melded trees, spliced in whole so a meld never
+    // copies them; none of them is empty
+    Segments absorbed;
+
+    void consolidate() {
+        if (pending.empty() && absorbed.empty()) {
+            return;
+        }
+        for (Roots& segment : absorbed) {
+            pending.insert(pending.end(), segment.begin(), segment.end());
+        }
+        absorbed.clear();
+        if (tree.root) {
+            pending.push_back(tree.root);
+        }
+        tree.root = tree.mergePairwise(pending);
+        pending.clear();
+    }
+
+public:
+    explicit LazyLeftistTree(const Compare& compare = Compare(), const Allocator& alloc = Allocator())
+        : tree(compare, alloc), pending(typename Roots::allocator_type(alloc)),
+          absorbed(typename Segments::allocator_type(alloc)) {}
+
+    ~LazyLeftistTree() {
+        if (tree.releasesInBulk()) {
+            return;
+        }
+        for (Node* heap : pending) {
+            tree.destroyTree(heap);
+        }
+        for (const Roots& segment : absorbed) {
+            for (Node* heap : segment) {
+                tree.destroyTree(heap);
+            }
+        }
+    }
+
+    bool isEmpty() const {
+        return tree.isEmpty() && pending.empty() && absorbed.empty();
+    }
+
+    // Number of keys, pending ones included. O(1)
+    size_t size() const {
+        return tree.count;
+    }
+
+    // Insert a new key; O(1), no merge happens until the next getMin/extractMin
+    void insert(const T& key) {
+        emplace(key);
+    }
+
+    void insert(T&& key) {
+        emplace(std::move(key));
+    }
+
+    template <typename... Args>
+    void emplace(Args&&... args) {
+        // Claim the slot first, so a throwing push_back can't leak the node
+        pending.push_back(nullptr);
+        try {
+            pending.back() = tree.pool->allocate(std::forward<Args>(args)...);
+        } catch (...) {
+            pending.pop_back();
+            throw;
+        }
+        ++tree.count; // Counted right away; consolidation doesn't change it
+    }
+
+    // Get the minimum key, merging any pending heaps first
+    const T& getMin() {
+        consolidate();
+        return tree.getMin();
+    }
+
+    T extractMin() {
+        consolidate();
+        return tree.extractMin();
+    }
+
+    T replaceTop(T key) {
+        consolidate();
+        return tree.replaceTop(std::move(key));
+    }
+
+    T pushPop(T key) {
+        consolidate();
+        return tree.pushPop(std::move(key));
+    }
+
+    template <typename OutputIt>
+    size_t extractMinBatch(size_t k, OutputIt out) {
+        consolidate();
+        return tree.extractMinBatch(k, out);
+    }
+
+    template <typename OutputIt>
+    size_t drainSorted(OutputIt out) {
+        consolidate();
+        return tree.drainSorted(out);
+    }
+
+    // Queue the other heap (consolidated part and pending lists) for a later
+    // merge. other's pending lists are spliced or moved over, never copied.
+    // Time Complexity: O(1) (pool adoption aside)
+    void mergeWith(LazyLeftistTree& otherTree) {
+        if (this == &otherTree) {
+            return;
+        }
+        tree.adoptPoolOf(otherTree.tree);
+        absorbed.splice(absorbed.end(), otherTree.absorbed);
+        if (!otherTree.pending.empty()) {
+            absorbed.push_back(std::move(otherTree.pending));
+            otherTree.pending = Roots(otherTree.pending.get_allocator());
+        }
+        if (otherTree.tree.root) {
+            pending.push_back(otherTree.tree.root);
+            otherTree.tree.root = nullptr;
+        }
+        tree.count += otherTree.tree.count;
+        otherTree.tree.count = 0;
+    }
+
+    void printTree() {
+        consolidate();
+        tree.printTree();
+    }
+};
+
+// Node of a PersistentLeftistHeap. Nodes are shared between heap versions, so
+// each one counts the links to it (from parent nodes and from heap roots).
+template <typename T>
+struct PersistentNode {
+    T key;
+    int npl;    // Null Path Length
+    uint32_t refs;
+    PersistentNode *left;
+    PersistentNode *right; // Also links free nodes in the pool
+
+    template <typename... Args>
+    explicit PersistentNode(in_place_t, Args&&... args)
+        : key(std::forward<Args>(args)...), npl(0), refs(1), left(nullptr), right(nullptr) {}
+};
+
+// Leftist heap with value semantics and structural sharing. Copying a heap is
+// O(1): both copies point at the same nodes. Nodes are never modified once
+// linked in; insert, extractMin and mergeWith copy only the merge path (the
+// right spines, O(log N) nodes) and share every other subtree, so other
+// versions never see the change. Nodes are reference counted and return to a
+// NodePool shared by all copies; like the pool, heaps stay single-threaded.
+template <typename T, typename Compare = less<T>, typename Allocator = allocator<T>>
+class PersistentLeftistHeap {
+public:
+    using Node = PersistentNode<T>;
+    using Pool = NodePool<Node, Allocator>;
+
+private:
+    static constexpr int kMaxMergePath = 2 * numeric_limits<size_t>::digits;
+
+    Node *root;
+    shared_ptr<Pool> pool;
+    Compare comp;
+    size_t count;
+
+    static int getNPL(const Node* node) {
+        return node ? node->npl : -1;
+    }
+
+    static Node* share(Node* node) {
+        if (node) ++node->refs;
+        return node;
+    }
+
+    // Drop one link to node, freeing every node that is no longer linked
+    void release(Node* node) {
+        if (node == nullptr || --node->refs > 0) {
+            return;
+        }
+        // Reused across calls so releasing doesn't allocate
+        static thread_local vector<Node*> dead;
+        dead.push_back(node);
+        while (!dead.empty()) {
+            Node* current = dead.back();
+            dead.pop_back();
+            for (Node* child : {current->left, current->right}) {
+                if (child && --child->refs == 0) dead.push_back(child);
+            }
+            pool->deallocate(current);
+        }
+    }
+
+    // Unlinked copy of node sharing its left subtree
+    Node* copyOf(const Node* node) {
+        Node* copy = pool->allocate(node->key);
+        copy->left = share(node->left);
+        copy->npl = node->npl;
+        return copy;
+    }
+
+    static void fixPath(Node* const* path, int depth) {
+        while (depth > 0) {
+            Node* node = path[--depth];
+            if (getNPL(node->left) < getNPL(node->right)) {
+                swap(node->left, node->right);
+            }
+            node->npl = getNPL(node->right) + 1;
+        }
+    }
+
+    // Merge without touching h1 or h2: the merged right path is built from
+    // copies, everything hanging off it is shared. Returns a new link.
+    Node* merge(Node* h1, Node* h2) {
+        if (h1 == nullptr || h2 == nullptr) {
+            return share(h1 ? h1 : h2);
+        }
+        if (comp(h2->key, h1->key)) {
+            swap(h1, h2);
+        }
+        Node* path[kMaxMergePath];
+        int depth = 0;
+        Node* mergedRoot = copyOf(h1);
+        Node* tail = mergedRoot;
+        Node* next = h1->right;
+        try {
+            while (true) {
+                path[depth++] = tail;
+                if (next == nullptr) {
+                    tail->right = share(h2);
+                    break;
+                }
+                if (comp(h2->key, next->key)) {
+                    swap(next, h2);
+                }
+                Node* copy = copyOf(next);
+                tail->right = copy;
+                tail = copy;
+                next = next->right;
+            }
+        } catch (...) {
+            release(mergedRoot);
+            throw;
+        }
+        fixPath(path, depth);
+        return mergedRoot;
+    }
+
+    // Merge the fresh childless node single into heap: copy the right spine down
+    // to where single fits, and let single take the rest of the spine as its
+    // left subtree. Consumes the caller's link to single.
+    Node* insertInto(Node* heap, Node* single) {
+        Node* path[kMaxMergePath + 1];
+        int depth = 0;
+        Node* mergedRoot = nullptr;
+        Node* tail = nullptr;
+        auto attach = [&](Node* node) {
+            (tail ? tail->right : mergedRoot) = node;
+            tail = node;
+            path[depth++] = node;
+        };
+        try {
+            while (heap != nullptr && comp(heap->key, single->key)) {
+                attach(copyOf(heap));
+                heap = heap->right;
+            }
+        } catch (...) {
+            release(mergedRoot);
+            release(single);
+            throw;
+        }
+        single->left = share(heap);
+        attach(single);
+        fixPath(path, depth);
+        return mergedRoot;
+    }
+
+public:
+    explicit PersistentLeftistHeap(const Compare& compare = Compare(), const Allocator& alloc = Allocator())
+        : root(nullptr), pool(make_shared<Pool>(alloc)), comp(compare), count(0) {}
+
+    // O(1) fork: the copy shares every node with other
+    PersistentLeftistHeap(const PersistentLeftistHeap& other)
+        : root(share(other.root)), pool(other.pool), comp(other.comp), count(other.count) {}
+
+    PersistentLeftistHeap(PersistentLeftistHeap&& other) noexcept
+        : root(exchange(other.root, nullptr)), pool(other.pool), comp(other.comp), count(exchange(other.count, 0)) {}
+
+    PersistentLeftistHeap& operator=(PersistentLeftistHeap other) noexcept {
+        swap(root, other.root);
+        swap(pool, other.pool);
+        swap(comp, other.comp);
+        swap(count, other.count);
+        return *this;
+    }
+
+    ~PersistentLeftistHeap() {
+        release(root);
+    }
+
+    bool isEmpty() const {
+        return root == nullptr;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    // Allocates at most O(log N) nodes
+    void insert(const T& key) {
+        Node* newRoot = insertInto(root, pool->allocate(key));
+        release(root);
+        root = newRoot;
+        ++count;
+    }
+
+    const T& getMin() const {
+        if (isEmpty()) {
+            throw runtime_error("Heap is empty!");
+        }
+        return root->key;
+    }
+
+    // Remove and return the minimum key. The key is copied: other versions may
+    // still hold its node. Allocates at most O(log N) nodes.
+    T extractMin() {
+        if (isEmpty()) {
+            throw runtime_error("Heap is empty! Cannot extract min.");
+        }
+        T minKey = root->key;
+        Node* newRoot = merge(root->left, root->right);
+        release(root);
+        root = newRoot;
+        --count;
+        return minKey;
+    }
+
+    // Meld other's keys into this heap; other itself is left unchanged
+    void mergeWith(const PersistentLeftistHeap& other) {
+        if (other.pool != pool) {
+            // Shared nodes of other's pool may be freed into ours
+            pool->retain(other.pool);
+        }
+        Node* newRoot = merge(root, other.root);
+        release(root);
+        root = newRoot;
+        count += other.count;
+    }
+
+    // True if both heaps are the same version (e.g. a fork neither has changed)
+    bool sharesRootWith(const PersistentLeftistHeap& other) const {
+        return root == other.root;
+    }
+
+    const shared_ptr<Pool>& getPool() const {
+        return pool;
+    }
+};
+
+// Double-ended heap: twin addressable leftist trees, one ordered by Compare and
+// one by its reverse, each node cross-linked to the node holding the same key
+// in the other tree. Extracting from either end pops one root and erases its
+// twin, both O(log N). With a capacity, pushEvicting keeps the smallest keys
+// and recycles the two nodes of the evicted maximum in place. Every key is
+// stored twice, once per tree.
+template <typename T, typename Compare = less<T>, typename Allocator = allocator<T>>
+class DoubleEndedLeftistHeap {
+private:
+    struct Entry;
+    using EntryNode = Node<Entry, true>;
+
+    struct Entry {
+        T key;
+        EntryNode *twin; // Node with the same key in the other tree
+    };
+
+    struct MinOrder {
+        Compare comp;
+        bool operator()(const Entry& a, const Entry& b) const {
+            return comp(a.key, b.key);
+        }
+    };
+
+    struct MaxOrder {
+        Compare comp;
+        bool operator()(const Entry& a, const Entry& b) const {
+            return comp(b.key, a.key);
+        }
+    };
+
+    using EntryAllocator = typename allocator_traits<Allocator>::template rebind_alloc<Entry>;
+    using MinTree = LeftistTree<Entry, MinOrder, EntryAllocator, true>;
+    using MaxTree = LeftistTree<Entry, MaxOrder, EntryAllocator, true>;
+
+    MinTree minTree;
+    MaxTree maxTree;
+    size_t limit;
+    Compare comp;
+
+    // Pop the root of from and erase its twin from other
+    template <typename From, typename Other>
+    static T extractRoot(From& from, Other& other) {
+        if (from.isEmpty()) {
+            throw runtime_error("Heap is empty! Cannot extract.");
+        }
+        EntryNode* twin = from.root->key.twin;
+        T key = std::move(from.root->key.key);
+        from.extractMin();
+        other.erase(typename Other::Handle(twin));
+        return key;
+    }
+
+public:
+    // capacity 0 means unbounded
+    explicit DoubleEndedLeftistHeap(size_t capacity = 0, const Compare& compare = Compare(),
+                                    const Allocator& alloc = Allocator())
+        : minTree(MinOrder{compare}, EntryAllocator(alloc)), maxTree(MaxOrder{compare}, EntryAllocator(alloc)),
+          limit(capacity), comp(compare) {}
+
+    bool isEmpty() const {
+        return minTree.isEmpty();
+    }
+
+    size_t size() const {
+        return minTree.size();
+    }
+
+    size_t capacity() const {
+        return limit;
+    }
+
+    // Insert key regardless of the capacity
+    void insert(const T& key) {
+        auto low = minTree.insert(Entry{key, nullptr});
+        try {
+            auto high = maxTree.insert(Entry{key, low.node});
+            low.node->key.twin = high.node;
+        } catch (...) {
+            minTree.erase(low);
+            throw;
+        }
+    }
+
+    const T& getMin() const {
+        return minTree.getMin().key;
+    }
+
+    const T& getMax() const {
+        return maxTree.getMin().key;
+    }
+
+    T extractMin() {
+        return extractRoot(minTree, maxTree);
+    }
+
+    T extractMax() {
+        return extractRoot(maxTree, minTree);
+    }
+
+    // Insert key into a bounded heap. Below capacity this is insert. At capacity
+    // the largest of the heap's keys and key is dropped and returned: key itself
+    // if it is no smaller than getMax(), touching nothing, or else the old
+    // maximum, whose two nodes are reused for key (a replaceTop in the max tree
+    // and a decreaseKey in the min tree, no allocation).
+    optional<T> pushEvicting(T key) {
+        if (limit == 0 || size() < limit) {
+            insert(key);
+            return nullopt;
+        }
+        if (!comp(key, getMax())) {
+            return key;
+        }
+        EntryNode* high = maxTree.root;
+        EntryNode* low = high->key.twin;
+        Entry evicted = maxTree.replaceTop(Entry{key, low});
+        minTree.decreaseKey(typename MinTree::Handle(low), Entry{std::move(key), high});
+        return std::move(evicted.key);
+    }
+};
+
+// Keeps the k smallest keys (by Compare) of a stream in a fixed set of k nodes.
+// The keys are held in a max-heap LeftistTree whose root is the current k-th
+// smallest key. Until k keys are held an offer is an insert; after that a key
+// that doesn't beat the root is rejected with one compare, and one that does
+// replaces the root in place (replaceTop), so no node is ever allocated or freed.
+template <typename T, typename Compare = less<T>, typename Allocator = allocator<T>>
+class BoundedTopK {
+private:
+    struct Reversed {
+        Compare comp;
+        bool operator()(const T& a, const T& b) const {
+            return comp(b, a);
+        }
+    };
+
+    LeftistTree<T, Reversed, Allocator> heap;
+    size_t limit;
+    Compare comp;
+
+    // Slow paths, split out so offer stays a single compare on the reject path
+    void replace(const T& key) {
+        heap.replaceTop(key);
+    }
+
+    void grow(const T& key) {
+        heap.insert(key);
+    }
+
+public:
+    explicit BoundedTopK(size_t k, const Compare& compare = Compare(), const Allocator& alloc = Allocator())
+        : heap(Reversed{compare}, alloc), limit(k), comp(compare) {
+        heap.getPool()->reserve(k);
+    }
+
+    // Offer key from the stream; returns whether it is (for now) among the k smallest
+    bool offer(const T& key) {
+        if (heap.size() >= limit) [[likely]] {
+            // Full, so the root exists (unless k = 0): read it unchecked
+            if (limit == 0 || !comp(key, heap.root->key)) [[likely]] {
+                return false;
+            }
+            replace(key);
+            return true;
+        }
+        grow(key);
+        return true;
+    }
+
+    size_t size() const {
+        return heap.size();
+    }
+
+    size_t capacity() const {
+        return limit;
+    }
+
+    bool isFull() const {
+        return heap.size() == limit;
+    }
+
+    // Largest key kept, i.e. the bar a new key has to beat once full
+    const T& threshold() const {
+        return heap.getMin();
+    }
+
+    // Move the kept keys into out in ascending order, leaving this empty
+    template <typename OutputIt>
+    size_t drainSorted(OutputIt out) {
+        vector<T> descending;
+        descending.reserve(heap.size());
+        heap.drainSorted(back_inserter(descending));
+        move(descending.rbegin(), descending.rend(), out);
+        return descending.size();
+    }
+};
+
+// Timer queue tuned for deadlines that mostly arrive in order, as with
+// "now + constant timeout". A key no smaller than the last appended one goes to
+// an append buffer that is sorted by construction (O(1) insert, O(1) pop); any
+// other key goes to a LeftistTree. The two are merged on the fly when popping,
+// and the buffer is only melded into the tree (one insertBatch chain, no sort)
+// when a single heap is needed, by mergeWith or meldAppends.
+template <typename T, typename Compare = less<T>, typename Allocator = allocator<T>>
+class TimerLeftistHeap {
+private:
+    LeftistTree<T, Compare, Allocator> tree;
+    vector<T> appends; // Sorted; the live keys are appends[head..]
+    size_t head;
+    Compare comp;
+
+    bool hasAppends() const {
+        return head < appends.size();
+    }
+
+    // Whether the next key comes from the buffer; ties go to the buffer
+    bool bufferFirst() const {
+        return hasAppends() && (tree.isEmpty() || !comp(tree.getMin(), appends[head]));
+    }
+
+    // Drop the popped prefix once the buffer is empty, or when it is at least
+    // half the buffer and the next append would reallocate anyway
+    void reclaim() {
+        if (head == appends.size()) {
+            appends.clear();
+            head = 0;
+        } else if (head >= appends.size() / 2 && appends.size() == appends.capacity()) {
+            appends.erase(appends.begin(), appends.begin() + static_cast<ptrdiff_t>(head));
+            head = 0;
+        }
+    }
+
+    template <typename U>
+    void insertKey(U&& key) {
+        if (!hasAppends() || !comp(key, appends.back())) {
+            reclaim();
+            appends.push_back(std::forward<U>(key));
+        } else {
+            tree.insert(std::forward<U>(key));
+        }
+    }
+
+public:
+    explicit TimerLeftistHeap(const Compare& compare = Compare(), const Allocator& alloc = Allocator())
+        : tree(compare, alloc), head(0), comp(compare) {}
+
+    void insert(const T& key) {
+        insertKey(key);
+    }
+
+    void insert(T&& key) {
+        insertKey(std::move(key));
+    }
+
+    bool isEmpty() const {
+        return tree.isEmpty() && !hasAppends();
+    }
+
+    size_t size() const {
+        return tree.size() + (appends.size() - head);
+    }
+
+    // Keys currently in the append buffer rather than the tree
+    size_t appendedCount() const {
+        return appends.size() - head;
+    }
+
+    const T& getMin() const {
+        if (isEmpty()) {
+            throw runtime_error("Heap is empty!");
+        }
+        return bufferFirst() ? appends[head] : tree.getMin();
+    }
+
+    T extractMin() {
+        if (isEmpty()) {
+            throw runtime_error("Heap is empty! Cannot extract min.");
+        }
+        if (!bufferFirst()) {
+            return tree.extractMin();
+        }
+        T minKey = std::move(appends[head++]);
+        if (head == appends.size()) reclaim();
+        return minKey;
+    }
+
+    // Pop every key that is not after now, in ascending order, into out, and
+    // return how many. The expired part of the buffer is found by binary search
+    // and merged with the tree's expired keys in one pass; once the tree has no
+    // more expired keys the rest of that range is moved out in bulk.
+    template <typename OutputIt>
+    size_t pollExpired(const T& now, OutputIt out) {
+        auto first = appends.begin() + static_cast<ptrdiff_t>(head);
+        auto last = upper_bound(first, appends.end(), now, comp);
+        size_t polled = 0;
+        while (!tree.isEmpty() && !comp(now, tree.getMin())) {
+            while (first != last && !comp(tree.getMin(), *first)) {
+                *out++ = std::move(*first++);
+                ++polled;
+            }
+            *out++ = tree.extractMin();
+            ++polled;
+        }
+        polled += static_cast<size_t>(last - first);
+        move(first, last, out);
+        head = static_cast<size_t>(last - appends.begin());
+        if (head == appends.size()) reclaim();
+        return polled;
+    }
+
+    // Meld the append buffer into the tree, leaving every key in the tree
+    void meldAppends() {
+        if (!hasAppends()) {
+            return;
+        }
+        tree.insertBatch(span<const T>(appends.data() + head, appends.size() - head));
+        appends.clear();
+        head = 0;
+    }
+
+    // Take every key of other, leaving it empty. Only the tree can absorb a second
+    // ordered run, so other's buffer is melded in.
+    void mergeWith(TimerLeftistHeap& other) {
+        if (this == &other) {
+            return;
+        }
+        other.meldAppends();
+        tree.mergeWith(other.tree);
+    }
+};
+
+// Pending event of an EventSimulation. Events are ordered by time; equal times
+// run in the order they were scheduled.
+template <typename Payload>
+struct SimulationEvent {
+    double time;
+    uint64_t sequence;
+    Payload payload;
+
+    bool operator<(const SimulationEvent& other) const {
+        return time < other.time || (time == other.time && sequence < other.sequence);
+    }
+};
+
+// Discrete-event simulation driver. The future event list is a Heap of
+// SimulationEvent<Payload>; any heap with insert, getMin, extractMin and isEmpty
+// works, so heap variants can be compared on the same model.
+template <typename Payload, typename Heap = LeftistTree<SimulationEvent<Payload>>>
+class EventSimulation {
+public:
+    using Event = SimulationEvent<Payload>;
+
+private:
+    Heap events;
+    double clock;
+    uint64_t nextSequence;
+    size_t pendingCount;
+
+public:
+    EventSimulation() : clock(0.0), nextSequence(0), pendingCount(0) {}
+
+    // Simulated time of the event being (or last) handled
+    double now() const {
+        return clock;
+    }
+
+    size_t pending() const {
+        return pendingCount;
+    }
+
+    void schedule(double delay, Payload payload) {
+        scheduleAt(clock + delay, std::move(payload));
+    }
+
+    void scheduleAt(double time, Payload payload) {
+        if (time < clock) {
+            throw invalid_argument("Cannot schedule an event in the past!");
+        }
+        events.insert(Event{time, nextSequence++, std::move(payload)});
+        ++pendingCount;
+    }
+
+    // Handle events in time order, advancing now() to each and calling
+    // handler(*this, payload), which may schedule more. Stops when no event is
+    // left, the next one is later than until, or maxEvents have run; returns the
+    // number handled.
+    template <typename Handler>
+    size_t run(Handler&& handler, double until = numeric_limits<double>::infinity(),
+               size_t maxEvents = numeric_limits<size_t>::max()) {
+        size_t handled = 0;
+        while (handled < maxEvents && !events.isEmpty() && !(until < events.getMin().time)) {
+            Event event = events.extractMin();
+            --pendingCount;
+            clock = event.time;
+            handler(*this, event.payload);
+            ++handled;
+        }
+        return handled;
+    }
+};
+
+// Hold-model increments, all with mean 1: exponential(1), uniform [0, 2),
+// bimodal (U[0, 0.2) with probability 0.9, else U[0, 18.2)) and triangular on
+// [0, 2] with mode 1
+enum class IncrementDistribution { Exponential, Uniform, Bimodal, Triangular };
+
+const char* incrementDistributionName(IncrementDistribution distribution) {
+    switch (distribution) {
+    case IncrementDistribution::Exponential: return "exponential";
+    case IncrementDistribution::Uniform: return "uniform";
+    case IncrementDistribution::Bimodal: return "bimodal";
+    case IncrementDistribution::Triangular: return "triangular";
+    }
+    return "unknown";
+}
+
+class HoldIncrement {
+private:
+    IncrementDistribution distribution;
+    mt19937_64 rng;
+    uniform_real_distribution<double> unit;
+    exponential_distribution<double> exponential;
+
+public:
+    HoldIncrement(IncrementDistribution d, uint64_t seed) : distribution(d), rng(seed), unit(0.0, 1.0), exponential(1.0) {}
+
+    double operator()() {
+        switch (distribution) {
+        case IncrementDistribution::Exponential: return exponential(rng);
+        case IncrementDistribution::Uniform: return 2.0 * unit(rng);
+        case IncrementDistribution::Bimodal: return unit(rng) < 0.9 ? 0.2 * unit(rng) : 18.2 * unit(rng);
+        case IncrementDistribution::Triangular: return unit(rng) + unit(rng);
+        }
+        return 1.0;
+    }
+};
+
+// On-disk image of one heap: this header followed by capacity CompactNode
+// records. Children are stored as record indices, never as pointers, so an image
+// can be mapped at any address and used in place.
+struct LeftistImageHeader {
+    char magic[8];
+    uint32_t keySize;  // sizeof(T), checked when mapping
+    uint32_t nodeSize; // sizeof(CompactNode), checked when mapping
+    uint64_t capacity; // Node records in the file
+    uint64_t used;     // Records handed out so far; the rest are unused
+    uint64_t count;    // Keys in the heap
+    uint32_t root;     // Root record, or kNull for an empty heap
+    uint32_t freeHead; // Free list, linked through CompactNode::right
+    uint8_t reserved[16];
+};
+
+static_assert(sizeof(LeftistImageHeader) == 64, "Image header layout changed");
+
+constexpr char kLeftistImageMagic[8] = {'L', 'T', 'H', 'E', 'A', 'P', '0', '1'};
+
+// Node storage for CompactLeftistTree: one contiguous arena addressed by 32-bit
+// indices instead of pointers. npl is bounded by log2(N) < 32, so a uint8_t is
+// enough, and for a 4-byte key a whole node packs into 16 bytes, four to a cache
+// line. The left index stays in the same record as key, right and npl: every level
+// of a merge's fix-up pass reads it, so a separate array would add a cache miss.
+// Like NodePool, an arena may be shared by several trees and is not thread-safe.
+// The records live either in a heap buffer or, for an arena opened with
+// mapImage, directly in a read-write file mapping.
+template <typename T>
+class CompactArena {
+public:
+    static_assert(is_trivially_copyable<T>::value, "CompactArena stores trivially copyable keys");
+
+    using Index = uint32_t;
+    static constexpr Index kNull = numeric_limits<Index>::max();
+
+    struct CompactNode {
+        T key;       // The value stored in the node
+        Index left;  // Index of the left child, kNull if none
+        Index right; // Index of the right child, kNull if none
+        uint8_t npl; // Null Path Length
+    };
+
+    CompactNode *nodes; // Heap buffer, or the records of a mapped image
+    Index freeHead;     // Recycled nodes, linked through CompactNode::right
+
+private:
+    size_t used;     // Records handed out so far
+    size_t capacity; // Records that fit in the current storage
+    LeftistImageHeader *image; // Start of the mapping, null for heap storage
+    int imageFd;
+
+    static size_t imageBytes(size_t records) {
+        return sizeof(LeftistImageHeader) + records * sizeof(CompactNode);
+    }
+
+    void grow() {
+        if (capacity >= kNull) {
+            throw length_error("CompactArena is full!");
+        }
+        size_t newCapacity = min<size_t>(max<size_t>(16, capacity * 2), kNull);
+        if (image) {
+            remapImage(newCapacity);
+            return;
+        }
+        // Keys are trivially copyable, so the records can be moved bytewise
+        void* grown = realloc(nodes, newCapacity * sizeof(CompactNode));
+        if (grown == nullptr) {
+            throw bad_alloc();
+        }
+        nodes = static_cast<CompactNode*>(grown);
+        capacity = newCapacity;
+    }
+
+    void remapImage(size_t newCapacity) {
+#if LEFTIST_TREE_HAS_MMAP
+        if (ftruncate(imageFd, static_cast<off_t>(imageBytes(newCapacity))) != 0) {
+            throw runtime_error("Cannot grow heap image!");
+        }
+        void* mapping = mmap(nullptr, imageBytes(newCapacity), PROT_READ | PROT_WRITE, MAP_SHARED, imageFd, 0);
+        if (mapping == MAP_FAILED) {
+            throw runtime_error("Cannot map heap image!");
+        }
+        if (image) {
+            munmap(image, imageBytes(capacity));
+        }
+        image = static_cast<LeftistImageHeader*>(mapping);
+        nodes = reinterpret_cast<CompactNode*>(image + 1);
+        capacity = newCapacity;
+        image->capacity = newCapacity;
+#else
+        (void)newCapacity;
+        throw runtime_error("Heap images need mmap support!");
+#endif
+    }
+
+public:
+    CompactArena() : nodes(nullptr), freeHead(kNull), used(0), capacity(0), image(nullptr), imageFd(-1) {}
+
+    ~CompactArena() {
+#if LEFTIST_TREE_HAS_MMAP
+        if (image) {
+            munmap(image, imageBytes(capacity));
+            close(imageFd);
+            return;
+        }
+#endif
+        free(nodes);
+    }
+
+    CompactArena(const CompactArena&) = delete;
+    CompactArena& operator=(const CompactArena&) = delete;
+
+    Index allocate(const T& key) {
+        Index node;
+        if (freeHead != kNull) {
+            node = freeHead;
+            freeHead = nodes[node].right;
+        } else {
+            if (used == capacity) {
+                grow();
+            }
+            node = static_cast<Index>(used++);
+        }
+        nodes[node] = CompactNode{key, kNull, kNull, 0};
+        return node;
+    }
+
+    void deallocate(Index node) {
+        nodes[node].right = freeHead;
+        freeHead = node;
+    }
+
+    // Bytes of arena storage per node
+    static constexpr size_t bytesPerNode() {
+        return sizeof(CompactNode);
+    }
+
+    bool isMapped() const {
+        return image != nullptr;
+    }
+
+    // Write the arena as an image whose heap starts at root
+    void writeImage(const string& path, Index root, size_t keyCount) const {
+        LeftistImageHeader header = {};
+        memcpy(header.magic, kLeftistImageMagic, sizeof(header.magic));
+        header.keySize = sizeof(T);
+        header.nodeSize = sizeof(CompactNode);
+        header.capacity = used;
+        header.used = used;
+        header.count = keyCount;
+        header.root = root;
+        header.freeHead = freeHead;
+        ofstream out(path, ios::binary | ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(nodes), static_cast<streamsize>(used * sizeof(CompactNode)));
+        if (!out) {
+            throw runtime_error("Cannot write heap image!");
+        }
+    }
+
+    // Use the image at path as this (empty) arena's storage, read-write and in
+    // place: only the header is read, records fault in as they are touched.
+    // Returns the heap's root and key count through root and keyCount.
+    void mapImage(const string& path, Index& root, size_t& keyCount) {
+#if LEFTIST_TREE_HAS_MMAP
+        assert(image == nullptr && used == 0);
+        int fd = open(path.c_str(), O_RDWR);
+        if (fd < 0) {
+            throw runtime_error("Cannot open heap image!");
+        }
+        LeftistImageHeader header;
+        struct stat info;
+        bool valid = pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+                     fstat(fd, &info) == 0 &&
+                     memcmp(header.magic, kLeftistImageMagic, sizeof(header.magic)) == 0 &&
+                     header.keySize == sizeof(T) && header.nodeSize == sizeof(CompactNode) &&
+                     header.used <= header.capacity && header.capacity <= kNull && header.count <= header.used &&
+                     (header.root == kNull || header.root < header.used) &&
+                     (header.freeHead == kNull || header.freeHead < header.used) &&
+                     static_cast<uint64_t>(info.st_size) >= imageBytes(header.capacity);
+        if (!valid) {
+            close(fd);
+            throw runtime_error("Not a heap image for this key type!");
+        }
+        free(nodes);
+        nodes = nullptr;
+        imageFd = fd;
+        capacity = 0;
+        remapImage(max<size_t>(header.capacity, 1));
+        used = header.used;
+        freeHead = header.freeHead;
+        root = header.root;
+        keyCount = header.count;
+#else
+        (void)path;
+        (void)root;
+        (void)keyCount;
+        throw runtime_error("Heap images need mmap support!");
+#endif
+    }
+
+    // Record the heap's metadata in a mapped image; durable also flushes the
+    // mapping to disk
+    void syncImage(Index root, size_t keyCount, bool durable) {
+#if LEFTIST_TREE_HAS_MMAP
+        if (image == nullptr) {
+            return;
+        }
+        image->used = used;
+        image->count = keyCount;
+        image->root = root;
+        image->freeHead = freeHead;
+        if (durable) {
+            msync(image, imageBytes(capacity), MS_SYNC);
+        }
+#else
+        (void)root;
+        (void)keyCount;
+        (void)durable;
+#endif
+    }
+};
+
+// Leftist min-heap over a CompactArena. Same operations and complexities as
+// LeftistTree; melding trees that share an arena is O(log N), while melding a
+// tree from another arena first copies its nodes over in O(M).
+template <typename T, typename Compare = less<T>>
+class CompactLeftistTree {
+public:
+    using Arena = CompactArena<T>;
+
+private:
+    using Index = typename Arena::Index;
+    static constexpr Index kNull = Arena::kNull;
+    static constexpr int kMaxMergePath = 2 * numeric_limits<Index>::digits;
+
+    Index root;
+    shared_ptr<Arena> arena;
+    Compare comp;
+    size_t count;
+    bool ownsImage; // Opened with mapImage: the image keeps our nodes
+
+    using CompactNode = typename Arena::CompactNode;
+
+    static int getNPL(const CompactNode* nodes, Index node) {
+        if (node == kNull) {
+            return -1;
+        }
+        return nodes[node].npl;
+    }
+
+    // Same two passes as LeftistTree::merge, on indices
+    Index merge(Index h1, Index h2) {
+        if (h1 == kNull) return h2;
+        if (h2 == kNull) return h1;
+
+        // Held in a local: stores to the uint8_t npl may alias arena->nodes itself
+        CompactNode* nodes = arena->nodes;
+        if (comp(nodes[h2].key, nodes[h1].key)) {
+            std::swap(h1, h2);
+        }
+
+        Index path[kMaxMergePath];
+        int depth = 0;
+        Index mergedRoot = h1;
+        while (true) {
+            path[depth++] = h1;
+            Index next = nodes[h1].right;
+            if (next == kNull) {
+                nodes[h1].right = h2;
+                break;
+            }
+            if (comp(nodes[h2].key, nodes[next].key)) {
+                std::swap(next, h2);
+            }
+            nodes[h1].right = next;
+            h1 = next;
+        }
+
+        while (depth > 0) {
+            auto& node = nodes[path[--depth]];
+            if (getNPL(nodes, node.left) < getNPL(nodes, node.right)) {
+                std::swap(node.left, node.right);
+            }
+            node.npl = static_cast<uint8_t>(getNPL(nodes, node.right) + 1);
+        }
+
+        return mergedRoot;
+    }
+
+    // Return every node of the subtree to the arena, rotating left children onto
+    // the right chain as LeftistTree::destroyTree does
+    void destroyTree(Index node) {
+        auto& nodes = arena->nodes;
+        while (node != kNull) {
+            Index leftChild = nodes[node].left;
+            if (leftChild != kNull) {
+                nodes[node].left = nodes[leftChild].right;
+                nodes[leftChild].right = node;
+                node = leftChild;
+            } else {
+                Index right = nodes[node].right;
+                arena->deallocate(node);
+                node = right;
+            }
+        }
+    }
+
+    // Copy the subtree at node of source into target, keeping its shape
+    static Index copyTree(Arena& target, const Arena& source, Index node) {
+        if (node == kNull) {
+            return kNull;
+        }
+        vector<pair<Index, Index>> stack; // (source node, copy)
+        Index copiedRoot = target.allocate(source.nodes[node].key);
+        stack.emplace_back(node, copiedRoot);
+        while (!stack.empty()) {
+            auto [from, to] = stack.back();
+            stack.pop_back();
+            const auto& original = source.nodes[from];
+            target.nodes[to].npl = original.npl;
+            if (original.left != kNull) {
+                Index copy = target.allocate(source.nodes[original.left].key);
+                target.nodes[to].left = copy;
+                stack.emplace_back(original.left, copy);
+            }
+            if (original.right != kNull) {
+                Index copy = target.allocate(source.nodes[original.right].key);
+                target.nodes[to].right = copy;
+                stack.emplace_back(original.right, copy);
+            }
+        }
+        return copiedRoot;
+    }
+
+public:
+    explicit CompactLeftistTree(const Compare& compare = Compare())
+        : root(kNull), arena(make_shared<Arena>()), comp(compare), count(0), ownsImage(false) {}
+
+    explicit CompactLeftistTree(shared_ptr<Arena> sharedArena, const Compare& compare = Compare())
+        : root(kNull), arena(std::move(sharedArena)), comp(compare), count(0), ownsImage(false) {}
+
+    // Open a heap written by saveImage. The file is mapped read-write and used in
+    // place, so startup does no per-node work; updates go straight to the image
+    // and are recorded in its header by flush() and by the destructor.
+    static unique_ptr<CompactLeftistTree> mapImage(const string& path, const Compare& compare = Compare()) {
+        auto tree = make_unique<CompactLeftistTree>(compare);
+        tree->arena->mapImage(path, tree->root, tree->count);
+        tree->ownsImage = true;
+        return tree;
+    }
+
+    // Write this heap to path as an image mapImage can open
+    void saveImage(const string& path) const {
+        if (arena.use_count() == 1) {
+            arena->writeImage(path, root, count);
+            return;
+        }
+        // Other trees' nodes share the arena; write only ours
+        Arena dense;
+        Index denseRoot = copyTree(dense, *arena, root);
+        dense.writeImage(path, denseRoot, count);
+    }
+
+    // Record root and size in the mapped image and sync it to disk
+    void flush() {
+        if (ownsImage) {
+            arena->syncImage(root, count, true);
+        }
+    }
+
+    // As with LeftistTree, moves only transfer the root (and a mapped image's
+    // ownership); the moved-from tree is left empty on the same arena, with a
+    // copy of the comparator. Copies would share nodes with the original, so
+    // there are none.
+    static constexpr bool kNothrowMove = is_nothrow_copy_constructible_v<Compare> && is_nothrow_swappable_v<Compare>;
+
+    CompactLeftistTree(CompactLeftistTree&& other) noexcept(kNothrowMove)
+        : root(exchange(other.root, kNull)), arena(other.arena), comp(other.comp), count(exchange(other.count, 0)),
+          ownsImage(exchange(other.ownsImage, false)) {}
+
+    CompactLeftistTree& operator=(CompactLeftistTree&& other) noexcept(kNothrowMove) {
+        if (this != &other) {
+            CompactLeftistTree moved(std::move(other));
+            swap(moved);
+        }
+        return *this;
+    }
+
+    CompactLeftistTree(const CompactLeftistTree&) = delete;
+    CompactLeftistTree& operator=(const CompactLeftistTree&) = delete;
+
+    void swap(CompactLeftistTree& other) noexcept(is_nothrow_swappable_v<Compare>) {
+        std::swap(root, other.root);
+        std::swap(arena, other.arena);
+        std::swap(comp, other.comp);
+        std::swap(count, other.count);
+        std::swap(ownsImage, other.ownsImage);
+    }
+
+    ~CompactLeftistTree() {
+        // The heap in a mapped image outlives us, ready for the next mapImage
+        if (ownsImage) {
+            arena->syncImage(root, count, false);
+            return;
+        }
+        // A private arena goes away with us; only shared arenas need the walk
+        if (arena.use_count() > 1) {
+            destroyTree(root);
+        }
+    }
+
+    bool isEmpty() const {
+        return root == kNull;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    void insert(const T& key) {
+        root = merge(root, arena->allocate(key));
+        ++count;
+    }
+
+    const T& getMin() const {
+        if (isEmpty()) {
+            throw runtime_error("Heap is empty!");
+        }
+        return arena->nodes[root].key;
+    }
+
+    T extractMin() {
+        if (isEmpty()) {
+            throw runtime_error("Heap is empty! Cannot extract min.");
+        }
+
+        Index oldRoot = root;
+        T minKey = arena->nodes[oldRoot].key;
+        root = merge(arena->nodes[oldRoot].left, arena->nodes[oldRoot].right);
+        arena->deallocate(oldRoot);
+        --count;
+        return minKey;
+    }
+
+    void mergeWith(CompactLeftistTree& otherTree) {
+        if (this == &otherTree) {
+            return;
+        }
+        Index otherRoot = otherTree.root;
+        if (otherTree.arena != arena) {
+            otherRoot = copyTree(*arena, *otherTree.arena, otherTree.root);
+            otherTree.destroyTree(otherTree.root);
+        }
+        root = merge(root, otherRoot);
+        otherTree.root = kNull;
+        count += otherTree.count;
+        otherTree.count = 0;
+    }
+
+    void clear() {
+        destroyTree(root);
+        root = kNull;
+        count = 0;
+    }
+
+    const shared_ptr<Arena>& getArena() const {
+        return arena;
+    }
+
+    bool isMapped() const {
+        return ownsImage;
+    }
+};
+
+// Leftist heap shared between threads. Producers build private LeftistTrees
+// without any synchronization and publish them with one O(log N) meld, so the
+// critical section per batch is a single merge of two right spines. Consumers
+// pop single elements or whole batches under the same short lock.
+// Publishing an exclusively owned local tree moves its pool's slabs into the
+// shared tree's pool; the local tree keeps its (now empty) pool and can go on
+// allocating without touching shared state.
+template <typename T, typename Compare = less<T>, typename Allocator = allocator<T>>
+class ConcurrentLeftistTree {
+public:
+    using Tree = LeftistTree<T, Compare, Allocator>;
+
+private:
+    mutable mutex lock;
+    Tree tree;
+
+public:
+    explicit ConcurrentLeftistTree(const Compare& compare = Compare(), const Allocator& alloc = Allocator())
+        : tree(compare, alloc) {}
+
+    bool isEmpty() const {
+        lock_guard<mutex> guard(lock);
+        return tree.isEmpty();
+    }
+
+    size_t size() const {
+        lock_guard<mutex> guard(lock);
+        return tree.size();
+    }
+
+    // Insert one key directly; prefer publish for bursts of keys
+    void insert(T key) {
+        lock_guard<mutex> guard(lock);
+        tree.insert(std::move(key));
+    }
+
+    // Meld every element of local into the shared heap, leaving local empty
+    void publish(Tree& local) {
+        if (local.isEmpty()) {
+            return;
+        }
+        lock_guard<mutex> guard(lock);
+        tree.mergeWith(local);
+    }
+
+    // Pop the minimum into out; returns false instead of throwing when empty
+    bool tryExtractMin(T& out) {
+        lock_guard<mutex> guard(lock);
+        if (tree.isEmpty()) {
+            return false;
+        }
+        out = tree.extractMin();
+        return true;
+    }
+
+    // Pop up to k smallest keys into out under one lock acquisition
+    template <typename OutputIt>
+    size_t tryExtractMinBatch(size_t k, OutputIt out) {
+        lock_guard<mutex> guard(lock);
+        return tree.extractMinBatch(k, out);
+    }
+};
+
+// Relaxed-priority heap for parallel schedulers, following the MultiQueue
+// pattern: c * P independent LeftistTree shards, each behind its own lock.
+// insert goes to a random shard; extractMin samples two shards and pops the
+// smaller of their minimums, so the result is close to, but not always, the
+// global minimum. When one sampled shard is empty the other donates a batch of
+// its smallest keys, melded in with mergeWith, to keep shards balanced.
+template <typename T, typename Compare = less<T>, typename Allocator = allocator<T>>
+class ShardedLeftistHeap {
+public:
+    using Tree = LeftistTree<T, Compare, Allocator>;
+
+private:
+    static constexpr int kSampleAttempts = 8; // Two-shard samples before a full sweep
+    static constexpr size_t kStealBatch = 32; // Keys moved to a starving shard
+
+    struct alignas(64) Shard {
+        mutex lock;
+        Tree tree;
+        atomic<bool> hasKeys; // Hint for sampling, read without the lock
+
+        Shard(const Compare& compare, const Allocator& alloc) : tree(compare, alloc), hasKeys(false) {}
+    };
+
+    vector<unique_ptr<Shard>> shards;
+    Compare comp;
+
+    size_t randomShard() const {
+        thread_local mt19937 rng(static_cast<unsigned>(hash<thread::id>()(this_thread::get_id())));
+        return rng() % shards.size();
+    }
+
+    // Move the donor's smallest keys into the starving shard; both are locked
+    void rebalance(Shard& donor, Shard& starving) {
+        vector<T> batch;
+        batch.reserve(kStealBatch);
+        donor.tree.extractMinBatch(kStealBatch, back_inserter(batch));
+        // Built from the starving shard's allocator, so the meld can keep the
+        // nodes in that shard's arena
+        Tree moved(make_move_iterator(batch.begin()), make_move_iterator(batch.end()), comp,
+                   starving.tree.getPool()->template getAllocator<Allocator>());
+        starving.tree.mergeWith(moved);
+        starving.hasKeys.store(!starving.tree.isEmpty(), memory_order_relaxed);
+        donor.hasKeys.store(!donor.tree.isEmpty(), memory_order_relaxed);
+    }
+
+    static bool popFrom(Shard& shard, T& out) {
+        if (shard.tree.isEmpty()) {
+            return false;
+        }
+        out = shard.tree.extractMin();
+        shard.hasKeys.store(!shard.tree.isEmpty(), memory_order_relaxed);
+        return true;
+    }
+
+public:
+    explicit ShardedLeftistHeap(size_t shardCount = 2 * max(1u, thread::hardware_concurrency()),
+                                const Compare& compare = Compare(), const Allocator& alloc = Allocator())
+        : comp(compare) {
+        for (size_t i = 0; i < max<size_t>(1, shardCount); ++i) {
+            shards.push_back(make_unique<Shard>(compare, alloc));
+        }
+    }
+
+    size_t shardCount() const {
+        return shards.size();
+    }
+
+    // Sum of the shard sizes, each read under its lock, so it is only a snapshot
+    // while other threads are active. O(shardCount())
+    size_t size() const {
+        size_t total = 0;
+        for (const unique_ptr<Shard>& shard : shards) {
+            lock_guard<mutex> guard(shard->lock);
+            total += shard->tree.size();
+        }
+        return total;
+    }
+
+    void insert(T key) {
+        Shard& shard = *shards[randomShard()];
+        lock_guard<mutex> guard(shard.lock);
+        shard.tree.insert(std::move(key));
+        shard.hasKeys.store(true, memory_order_relaxed);
+    }
+
+    // Meld a locally built heap into one random shard, leaving local empty
+    void publish(Tree& local) {
+        if (local.isEmpty()) {
+            return;
+        }
+        Shard& shard = *shards[randomShard()];
+        lock_guard<mutex> guard(shard.lock);
+        shard.tree.mergeWith(local);
+        shard.hasKeys.store(true, memory_order_relaxed);
+    }
+
+    // Pop an approximately minimal key into out. Returns false only if a full
+    // sweep found every shard empty.
+    bool tryExtractMin(T& out) {
+        if (shards.size() > 1) {
+            for (int attempt = 0; attempt < kSampleAttempts; ++attempt) {
+                Shard& a = *shards[randomShard()];
+                Shard& b = *shards[randomShard()];
+                if (&a == &b || (!a.hasKeys.load(memory_order_relaxed) && !b.hasKeys.load(memory_order_relaxed))) {
+                    continue;
+                }
+                // try_lock on both never deadlocks; a busy shard just means another sample
+                unique_lock<mutex> lockA(a.lock, try_to_lock);
+                if (!lockA.owns_lock()) continue;
+                unique_lock<mutex> lockB(b.lock, try_to_lock);
+                if (!lockB.owns_lock()) continue;
+                if (a.tree.isEmpty() && b.tree.isEmpty()) continue;
+
+                Shard* best = &a;
+                Shard* other = &b;
+                if (a.tree.isEmpty() || (!b.tree.isEmpty() && comp(b.tree.getMin(), a.tree.getMin()))) {
+                    swap(best, other);
+                }
+                popFrom(*best, out);
+                if (other->tree.isEmpty() && !best->tree.isEmpty()) {
+                    rebalance(*best, *other);
+                }
+                return true;
+            }
+        }
+        for (unique_ptr<Shard>& shard : shards) {
+            lock_guard<mutex> guard(shard->lock);
+            if (popFrom(*shard, out)) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Measures how far a relaxed priority queue strays from strict order. The rank
+// error of a popped key is the number of still-queued keys strictly smaller than
+// it (0 for an exact heap). Keys must lie in [0, universe); pushes and pops are
+// reported by the caller, e.g. from a sequential replay.
+class RankErrorMeter {
+private:
+    vector<long long> counts; // Fenwick tree over key values
+    long long pops;
+    long long totalError;
+    long long maxError;
+
+    long long countBelow(size_t key) const {
+        long long sum = 0;
+        for (size_t i = key; i > 0; i -= i & (~i + 1)) {
+            sum += counts[i];
+        }
+        return sum;
+    }
+
+    void add(size_t key, long long delta) {
+        for (size_t i = key + 1; i < counts.size(); i += i & (~i + 1)) {
+            counts[i] += delta;
+        }
+    }
+
+public:
+    explicit RankErrorMeter(size_t universe) : counts(universe + 1, 0), pops(0), totalError(0), maxError(0) {}
+
+    void pushed(size_t key) {
+        add(key, 1);
+    }
+
+    void popped(size_t key) {
+        long long error = countBelow(key);
+        add(key, -1);
+        ++pops;
+        totalError += error;
+        maxError = max(maxError, error);
+    }
+
+    double meanRankError() const {
+        return pops == 0 ? 0.0 : static_cast<double>(totalError) / static_cast<double>(pops);
+    }
+
+    long long maxRankError() const {
+        return maxError;
+    }
+};
+
+// Merges many sorted runs into one ascending stream. Each run is pulled through
+// its reader into a read-ahead buffer, and a LeftistTree holds one (key, run)
+// head per run. Emitting a key replaces the top with that run's next key in one
+// fused replaceTop; only an exhausted run costs an extractMin. Equal keys come
+// out in run order.
+template <typename T, typename Compare = less<T>>
+class KWayMerger {
+public:
+    using RunId = uint32_t;
+    // Fills up to capacity keys of the run, in order, into buffer and returns how
+    // many it wrote; 0 means the run is exhausted
+    using RunReader = function<size_t(T* buffer, size_t capacity)>;
+
+private:
+    struct Head {
+        T key;
+        RunId run;
+    };
+
+    struct HeadCompare {
+        Compare comp;
+
+        bool operator()(const Head& a, const Head& b) const {
+            if (comp(a.key, b.key)) return true;
+            if (comp(b.key, a.key)) return false;
+            return a.run < b.run;
+        }
+    };
+
+    struct Run {
+        RunReader reader;
+        vector<T> buffer;
+        size_t next;
+        size_t filled;
+    };
+
+    vector<Run> runs;
+    LeftistTree<Head, HeadCompare> heads;
+    size_t readAhead;
+
+    // Refill run's buffer from its reader; false once the run is exhausted
+    bool refill(Run& run) {
+        run.next = 0;
+        run.filled = run.reader(run.buffer.data(), run.buffer.size());
+        return run.filled > 0;
+    }
+
+public:
+    explicit KWayMerger(size_t readAheadKeys = 256, const Compare& compare = Compare())
+        : heads(HeadCompare{compare}), readAhead(max<size_t>(readAheadKeys, 1)) {}
+
+    // Add a run. Runs can be added at any time; keys of a late run only have to
+    // be ordered among themselves and are merged from the next read on.
+    RunId addRun(RunReader reader) {
+        if (runs.size() >= numeric_limits<RunId>::max()) {
+            throw length_error("Too many runs!");
+        }
+        RunId id = static_cast<RunId>(runs.size());
+        runs.push_back(Run{std::move(reader), vector<T>(readAhead), 0, 0});
+        Run& run = runs.back();
+        if (refill(run)) {
+            heads.insert(Head{std::move(run.buffer[run.next++]), id});
+        }
+        return id;
+    }
+
+    // Write up to capacity merged keys into out. Returns the number written,
+    // which is less than capacity only once every run is exhausted.
+    size_t read(T* out, size_t capacity) {
+        size_t written = 0;
+        while (written < capacity && !heads.isEmpty()) {
+            const Head& top = heads.getMin();
+            Run& run = runs[top.run];
+            if (run.next < run.filled || refill(run)) {
+                out[written++] = heads.replaceTop(Head{std::move(run.buffer[run.next++]), top.run}).key;
+            } else {
+                out[written++] = heads.extractMin().key;
+            }
+        }
+        return written;
+    }
+
+    bool isDone() const {
+        return heads.isEmpty();
+    }
+
+    size_t runCount() const {
+        return runs.size();
+    }
+};
+
+// Awaitable front end for single-threaded event loops. A consumer does
+// co_await queue.pop() and suspends while the queue is empty; insert, insertBatch
+// and mergeWith hand keys straight to suspended consumers and resume them inline,
+// so there is no thread or scheduler round-trip. Waiters are served in FIFO
+// order, and a batch is melded in whole before anyone is resumed, so each waiter
+// wakes at most once per batch and receives the smallest keys of it.
+// Suspended consumers must be drained or close()d before the queue is destroyed.
+template <typename T, typename Compare = less<T>, typename Allocator = allocator<T>>
+class AsyncLeftistQueue {
+public:
+    class PopAwaiter {
+    private:
+        AsyncLeftistQueue* queue;
+        PopAwaiter* next;
+        coroutine_handle<> consumer;
+        optional<T> handed;
+
+        friend class AsyncLeftistQueue;
+
+        explicit PopAwaiter(AsyncLeftistQueue* owner) : queue(owner), next(nullptr) {}
+
+    public:
+        bool await_ready() const noexcept {
+            return !queue->heap.isEmpty() || queue->closed;
+        }
+
+        void await_suspend(coroutine_handle<> handle) noexcept {
+            consumer = handle;
+            if (queue->waitTail) {
+                queue->waitTail->next = this;
+            } else {
+                queue->waitHead = this;
+            }
+            queue->waitTail = this;
+            ++queue->waiters;
+        }
+
+        T await_resume() {
+            if (handed) {
+                return std::move(*handed);
+            }
+            if (queue->heap.isEmpty()) {
+                throw runtime_error("Pop from closed AsyncLeftistQueue!");
+            }
+            return queue->heap.extractMin();
+        }
+    };
+
+private:
+    LeftistTree<T, Compare, Allocator> heap;
+    PopAwaiter* waitHead;
+    PopAwaiter* waitTail;
+    size_t waiters;
+    bool closed;
+
+    // Detach the first n waiters as a chain, so consumers that await again while
+    // being resumed queue up behind it instead of inside it
+    PopAwaiter* detachWaiters(size_t n) {
+        PopAwaiter* first = waitHead;
+        PopAwaiter* last = nullptr;
+        for (size_t i = 0; i < n; ++i) {
+            last = last ? last->next : waitHead;
+        }
+        waitHead = last->next;
+        if (!waitHead) {
+            waitTail = nullptr;
+        }
+        last->next = nullptr;
+        waiters -= n;
+        return first;
+    }
+
+    static void resumeChain(PopAwaiter* waiter) {
+        while (waiter) {
+            // The awaiter lives in the consumer's frame, which may be gone after resume
+            PopAwaiter* next = waiter->next;
+            waiter->consumer.resume();
+            waiter = next;
+        }
+    }
+
+    // Hand the smallest keys to as many waiters as there are keys, then resume them
+    void wakeWaiters() {
+        size_t n = min(waiters, heap.size());
+        if (n == 0) {
+            return;
+        }
+        PopAwaiter* chain = detachWaiters(n);
+        for (PopAwaiter* waiter = chain; waiter; waiter = waiter->next) {
+            waiter->handed.emplace(heap.extractMin());
+        }
+        resumeChain(chain);
+    }
+
+public:
+    explicit AsyncLeftistQueue(const Compare& compare = Compare(), const Allocator& alloc = Allocator())
+        : heap(compare, alloc), waitHead(nullptr), waitTail(nullptr), waiters(0), closed(false) {}
+
+    AsyncLeftistQueue(const AsyncLeftistQueue&) = delete;
+    AsyncLeftistQueue& operator=(const AsyncLeftistQueue&) = delete;
+
+    // Awaitable yielding the minimum key; completes immediately if one is queued.
+    // Once closed, pops drain what is left and then throw runtime_error.
+    PopAwaiter pop() {
+        return PopAwaiter(this);
+    }
+
+    // Insert key, or give it directly to the longest-waiting consumer and resume
+    // that consumer before returning
+    void insert(const T& key) {
+        insert(T(key));
+    }
+
+    void insert(T&& key) {
+        if (closed) {
+            throw runtime_error("Insert into closed AsyncLeftistQueue!");
+        }
+        if (waitHead == nullptr) {
+            heap.insert(std::move(key));
+            return;
+        }
+        PopAwaiter* waiter = detachWaiters(1);
+        waiter->handed.emplace(std::move(key));
+        resumeChain(waiter);
+    }
+
+    // Meld the whole batch, then wake up to batch.size() waiters once each
+    void insertBatch(span<const T> batch) {
+        if (closed) {
+            throw runtime_error("Insert into closed AsyncLeftistQueue!");
+        }
+        heap.insertBatch(batch);
+        wakeWaiters();
+    }
+
+    // Take every key of otherTree, leaving it empty, then wake waiters as above
+    void mergeWith(LeftistTree<T, Compare, Allocator>& otherTree) {
+        if (closed) {
+            throw runtime_error("Insert into closed AsyncLeftistQueue!");
+        }
+        heap.mergeWith(otherTree);
+        wakeWaiters();
+    }
+
+    // Refuse further inserts and resume every waiter; their pops throw
+    void close() {
+        closed = true;
+        if (waiters > 0) {
+            resumeChain(detachWaiters(waiters));
+        }
+    }
+
+    bool isClosed() const {
+        return closed;
+    }
+
+    bool isEmpty() const {
+        return heap.isEmpty();
+    }
+
+    size_t size() const {
+        return heap.size();
+    }
+
+    // Consumers currently suspended in pop()
+    size_t waiterCount() const {
+        return waiters;
+    }
+};
+
+// Counts, per thread, the calls that reach the system allocator through
+// CountingAllocator
+struct AllocationCounter {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+};
+
+inline AllocationCounter& allocationCounter() {
+    thread_local AllocationCounter counter;
+    return counter;
+}
+
+template <typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    CountingAllocator() = default;
+
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        ++allocationCounter().allocations;
+        allocationCounter().bytes += n * sizeof(T);
+        return allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        allocator<T>().deallocate(p, n);
+    }
+
+    template <typename U>
+    bool operator==(const CountingAllocator<U>&) const noexcept {
+        return true;
+    }
+};
+
+// Stateful allocator for tests: counts allocations per tag (0-3), and
+// allocators with different tags compare unequal
+inline uint64_t (&taggedAllocations())[4] {
+    static uint64_t counts[4] = {};
+    return counts;
+}
+
+template <typename T>
+struct TaggedAllocator {
+    using value_type = T;
+
+    int tag = 0;
+
+    TaggedAllocator() = default;
+
+    explicit TaggedAllocator(int t) : tag(t) {}
+
+    template <typename U>
+    TaggedAllocator(const TaggedAllocator<U>& other) noexcept : tag(other.tag) {}
+
+    T* allocate(size_t n) {
+        ++taggedAllocations()[tag];
+        return allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        allocator<T>().deallocate(p, n);
+    }
+
+    template <typename U>
+    bool operator==(const TaggedAllocator<U>& other) const noexcept {
+        return tag == other.tag;
+    }
+};
+
+// Eager coroutine that owns its own frame: it runs until its first suspension on
+// creation and frees itself when it finishes. Enough to drive AsyncLeftistQueue
+// consumers from a plain function without an executor.
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() noexcept {
+            return {};
+        }
+
+        suspend_never initial_suspend() noexcept {
+            return {};
+        }
+
+        suspend_never final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() noexcept {}
+
+        void unhandled_exception() noexcept {
+            terminate();
+        }
+    };
+};
+
+void testLeftistTree() {
+    cout << "Starting LeftistTree tests..." << endl;
+
+    // Test 1: Basic insert and getMin
+    LeftistTree<int> lt1;
+    lt1.insert(10);
+    lt1.insert(5);
+    lt1.insert(20);
+    assert(lt1.getMin() == 5 && "Test 1 Failed: Basic insert and getMin");
+    cout << "Test 1 Passed." << endl;
+
+    // Test 2: ExtractMin
+    assert(lt1.extractMin() == 5 && "Test 2 Failed: First extractMin");
+    assert(lt1.getMin() == 10 && "Test 2 Failed: getMin after first extract");
+    assert(lt1.extractMin() == 10 && "Test 2 Failed: Second extractMin");
+    assert(lt1.getMin() == 20 && "Test 2 Failed: getMin after second extract");
+    assert(lt1.extractMin() == 20 && "Test 2 Failed: Third extractMin");
+    assert(lt1.isEmpty() && "Test 2 Failed: isEmpty after all extracts");
+    cout << "Test 2 Passed." << endl;
+
+    // Test 3: Insert multiple elements and extract all
+    LeftistTree<int> lt2;
+    lt2.insert(15);
+    lt2.insert(3);
+    lt2.insert(8);
+    lt2.insert(1);
+    lt2.insert(12);
+    assert(lt2.getMin() == 1 && "Test 3 Failed: getMin with multiple inserts");
+    assert(lt2.extractMin() == 1 && "Test 3 Failed: extractMin 1");
+    assert(lt2.extractMin() == 3 && "Test 3 Failed: extractMin 3");
+    assert(lt2.extractMin() == 8 && "Test 3 Failed: extractMin 8");
+    assert(lt2.extractMin() == 12 && "Test 3 Failed: extractMin 12");
+    assert(lt2.extractMin() == 15 && "Test 3 Failed: extractMin 15");
+    assert(lt2.isEmpty() && "Test 3 Failed: isEmpty after all extracts");
+    cout << "Test 3 Passed." << endl;
+
+    // Test 4: Merging trees
+    LeftistTree<int> lt3a, lt3b;
+    lt3a.insert(10); lt3a.insert(20); lt3a.insert(5);
+    lt3b.insert(15); lt3b.insert(8); lt3b.insert(25);
+    lt3a.mergeWith(lt3b);
+    assert(lt3b.isEmpty() && "Test 4 Failed: Merged tree B is not empty");
+    assert(!lt3a.isEmpty() && "Test 4 Failed: Merged tree A is empty");
+
+    vector<int> extracted_merged;
+    while(!lt3a.isEmpty()) {
+        extracted_merged.push_back(lt3a.extractMin());
+    }
+    vector<int> expected_merged = {5, 8, 10, 15, 20, 25};
+    assert(extracted_merged == expected_merged && "Test 4 Failed: Merged tree elements incorrect");
+    cout << "Test 4 Passed." << endl;
+
+    // Test 5: Merging an empty tree
+    LeftistTree<int> lt4a, lt4b;
+    lt4a.insert(100);
+    lt4a.mergeWith(lt4b);
+    assert(lt4a.getMin() == 100 && "Test 5 Failed: Merging with empty tree");
+    assert(lt4b.isEmpty() && "Test 5 Failed: Empty tree changed after merge");
+    assert(lt4a.extractMin() == 100 && "Test 5 Failed: Extract after merge with empty");
+    assert(lt4a.isEmpty() && "Test 5 Failed: Not empty after extract");
+
+    lt4b.insert(200);
+    lt4b.mergeWith(lt4a);
+    assert(lt4b.getMin() == 200 && "Test 5 Failed: Merging empty into non-empty");
+    assert(lt4a.isEmpty() && "Test 5 Failed: Empty tree changed after merge");
+    assert(lt4b.extractMin() == 200 && "Test 5 Failed: Extract after merge empty into non-empty");
+    assert(lt4b.isEmpty() && "Test 5 Failed: Not empty after extract");
+    cout << "Test 5 Passed." << endl;
+
+
+    // Test 6: Operations on empty tree (should throw exceptions)
+    LeftistTree<int> emptyLt;
+    assert(emptyLt.isEmpty() && "Test 6 Failed: Newly created tree is not empty");
+    try {
+        emptyLt.getMin();
+        assert(false && "Test 6 Failed: getMin on empty tree did not throw");
+    } catch (const runtime_error& e) {
+        assert(string(e.what()) == "Heap is empty!" && "Test 6 Failed: getMin exception message incorrect");
+    }
+    try {
+        emptyLt.extractMin();
+        assert(false && "Test 6 Failed: extractMin on empty tree did not throw");
+    } catch (const runtime_error& e) {
+        assert(string(e.what()) == "Heap is empty! Cannot extract min." && "Test 6 Failed: extractMin exception message incorrect");
+    }
+    cout << "Test 6 Passed." << endl;
+
+     // Test 7: Merging a tree with itself
+    LeftistTree<int> lt7;
+    lt7.insert(50);
+    lt7.insert(30);
+    lt7.insert(70);
+    lt7.mergeWith(lt7);
+
+    assert(lt7.getMin() == 30 && "Test 7 Failed: Merging with self changed min");
+    vector<int> extracted_self_merge;
+    while(!lt7.isEmpty()) {
+        extracted_self_merge.push_back(lt7.extractMin());
+    }
+     vector<int> expected_self_merge = {30, 50, 70};
+    assert(extracted_self_merge == expected_self_merge && "Test 7 Failed: Merging with self corrupted tree");
+    cout << "Test 7 Passed." << endl;
+
+    // Test 8: Node pool reuse and shared pools
+    LeftistTree<int> lt8;
+    for (int i = 0; i < 5000; ++i) lt8.insert(5000 - i);
+    size_t slabsAfterFill = lt8.getPool()->slabCount();
+    while (!lt8.isEmpty()) lt8.extractMin();
+    for (int i = 0; i < 5000; ++i) lt8.insert(i);
+    assert(lt8.getPool()->slabCount() == slabsAfterFill && "Test 8 Failed: Freed nodes were not reused");
+
+    shared_ptr<LeftistTree<int>::Pool> sharedPool = make_shared<LeftistTree<int>::Pool>();
+    LeftistTree<int> lt8a(sharedPool), lt8b(sharedPool);
+    lt8a.insert(3); lt8a.insert(1);
+    lt8b.insert(2); lt8b.insert(0);
+    lt8a.mergeWith(lt8b);
+    lt8.mergeWith(lt8a); // Different pool still referenced elsewhere: retained, not absorbed
+    assert(sharedPool->slabCount() == 1 && "Test 8 Failed: Shared pool was absorbed");
+    LeftistTree<int> lt8c;
+    lt8c.insert(-1);
+    lt8.mergeWith(lt8c); // Exclusively owned pool: absorbed
+    assert(lt8c.getPool()->slabCount() == 0 && "Test 8 Failed: Exclusive pool was not absorbed");
+    assert(lt8.extractMin() == -1 && lt8.extractMin() == 0 && lt8.extractMin() == 0 && "Test 8 Failed: Merged pool contents incorrect");
+    cout << "Test 8 Passed." << endl;
+
+    // Test 9: Teardown of a degenerate left-heavy tree
+    {
+        // Descending inserts build a left chain as deep as the tree; a shared pool
+        // forces a node-by-node teardown instead of a bulk release.
+        shared_ptr<LeftistTree<int>::Pool> chainPool = make_shared<LeftistTree<int>::Pool>();
+        LeftistTree<int> lt9(chainPool);
+        for (int i = 1000000; i > 0; --i) lt9.insert(i);
+        assert(lt9.getMin() == 1 && "Test 9 Failed: getMin on left chain");
+    }
+    cout << "Test 9 Passed." << endl;
+
+    // Test 10: Move-only payloads with a custom comparator
+    struct Job {
+        long deadline;
+        int id;
+        unique_ptr<string> payload;
+    };
+    struct EarlierDeadline {
+        bool operator()(const Job& a, const Job& b) const {
+            return a.deadline != b.deadline ? a.deadline < b.deadline : a.id < b.id;
+        }
+    };
+    LeftistTree<Job, EarlierDeadline> jobs;
+    jobs.insert(Job{30, 1, make_unique<string>("c")});
+    jobs.insert(Job{10, 2, make_unique<string>("a")});
+    jobs.emplace(Job{20, 3, make_unique<string>("b")});
+    jobs.insert(Job{10, 1, make_unique<string>("z")});
+    assert(jobs.getMin().id == 1 && *jobs.getMin().payload == "z" && "Test 10 Failed: getMin tie-break");
+    Job first = jobs.extractMin();
+    assert(first.deadline == 10 && *first.payload == "z" && "Test 10 Failed: extractMin moved payload");
+    assert(*jobs.extractMin().payload == "a" && "Test 10 Failed: second extractMin");
+    assert(*jobs.extractMin().payload == "b" && "Test 10 Failed: third extractMin");
+    assert(!jobs.isEmpty() && "Test 10 Failed: remaining job lost"); // Destructor frees the last payload
+
+    LeftistTree<int, greater<int>> maxHeap;
+    for (int key : {4, 9, 1, 7}) maxHeap.insert(key);
+    assert(maxHeap.extractMin() == 9 && maxHeap.extractMin() == 7 && "Test 10 Failed: greater<int> ordering");
+    static_assert(sizeof(Node<int>) == sizeof(int) * 2 + sizeof(void*) * 2, "Node<int> layout grew");
+    cout << "Test 10 Passed." << endl;
+
+    // Test 11: Bottom-up heapify from a range
+    vector<int> batch;
+    mt19937 rng11(11);
+    for (int i = 0; i < 10000; ++i) batch.push_back(static_cast<int>(rng11() % 1000));
+    LeftistTree<int> lt11(batch.begin(), batch.end());
+    vector<int> drained;
+    while (!lt11.isEmpty()) drained.push_back(lt11.extractMin());
+    vector<int> sortedBatch = batch;
+    sort(sortedBatch.begin(), sortedBatch.end());
+    assert(drained == sortedBatch && "Test 11 Failed: Heapified range drains out of order");
+
+    lt11.insert(42);
+    istringstream stream11("8 3 5");
+    lt11.assign(istream_iterator<int>(stream11), istream_iterator<int>());
+    assert(lt11.extractMin() == 3 && lt11.extractMin() == 5 && lt11.extractMin() == 8 && "Test 11 Failed: assign from input iterators");
+    assert(lt11.isEmpty() && "Test 11 Failed: assign did not replace old contents");
+    lt11.assign(batch.begin(), batch.begin());
+    assert(lt11.isEmpty() && "Test 11 Failed: assign from empty range");
+    cout << "Test 11 Passed." << endl;
+
+    // Test 12: Handles with decreaseKey and erase
+    AddressableLeftistTree<int> lt12;
+    auto h50 = lt12.insert(50);
+    auto h40 = lt12.insert(40);
+    lt12.insert(10);
+    auto h30 = lt12.insert(30);
+    lt12.decreaseKey(h50, 5);
+    assert(lt12.getMin() == 5 && *h50 == 5 && "Test 12 Failed: decreaseKey to new minimum");
+    lt12.erase(h40);
+    lt12.decreaseKey(h30, 30); // Equal key is allowed and changes nothing
+    try {
+        lt12.decreaseKey(h30, 31);
+        assert(false && "Test 12 Failed: increasing a key did not throw");
+    } catch (const invalid_argument&) {
+    }
+    assert(lt12.extractMin() == 5 && lt12.extractMin() == 10 && lt12.extractMin() == 30 && "Test 12 Failed: order after erase");
+    assert(lt12.isEmpty() && "Test 12 Failed: erased element still present");
+
+    // Randomized against a sorted model
+    mt19937 rng12(12);
+    vector<AddressableLeftistTree<int>::Handle> handles12;
+    vector<int> model12;
+    for (int i = 0; i < 4000; ++i) {
+        int key = static_cast<int>(rng12() % 100000);
+        handles12.push_back(lt12.insert(key));
+    }
+    for (size_t i = 0; i < handles12.size(); ++i) {
+        switch (rng12() % 3) {
+            case 0: lt12.erase(handles12[i]); break;
+            case 1: lt12.decreaseKey(handles12[i], *handles12[i] - static_cast<int>(rng12() % 50000)); // fallthrough
+            default: model12.push_back(*handles12[i]); break;
+        }
+    }
+    AddressableLeftistTree<int> other12;
+    other12.insert(-1);
+    lt12.mergeWith(other12); // Handles stay valid after melding
+    model12.push_back(-1);
+    sort(model12.begin(), model12.end());
+    vector<int> drained12;
+    while (!lt12.isEmpty()) drained12.push_back(lt12.extractMin());
+    assert(drained12 == model12 && "Test 12 Failed: randomized decreaseKey/erase");
+    cout << "Test 12 Passed." << endl;
+
+    // Test 13: Lazy merge mode
+    LazyLeftistTree<int> lazy1, lazy2;
+    for (int key : {7, 3, 9}) lazy1.insert(key);
+    for (int key : {8, 1, 4}) lazy2.insert(key);
+    assert(lazy1.getMin() == 3 && "Test 13 Failed: getMin consolidates pending inserts");
+    lazy1.insert(2);
+    lazy1.mergeWith(lazy2);
+    assert(lazy2.isEmpty() && !lazy1.isEmpty() && "Test 13 Failed: lazy mergeWith");
+    lazy1.mergeWith(lazy1);
+    vector<int> drained13;
+    while (!lazy1.isEmpty()) drained13.push_back(lazy1.extractMin());
+    vector<int> expected13 = {1, 2, 3, 4, 7, 8, 9};
+    assert(drained13 == expected13 && "Test 13 Failed: lazy drain order");
+
+    LazyLeftistTree<unique_ptr<int>, function<bool(const unique_ptr<int>&, const unique_ptr<int>&)>> lazyOwned(
+        [](const unique_ptr<int>& a, const unique_ptr<int>& b) { return *a < *b; });
+    lazyOwned.insert(make_unique<int>(2));
+    lazyOwned.insert(make_unique<int>(1));
+    assert(*lazyOwned.extractMin() == 1 && "Test 13 Failed: lazy move-only extract");
+    lazyOwned.insert(make_unique<int>(0)); // Left pending; the destructor must free it
+
+    // Bulk insert grows the pending list geometrically: a few dozen allocations
+    // for 100k keys (one per insert if the list were regrown each time)
+    {
+        LazyLeftistTree<int, less<int>, CountingAllocator<int>> bulk13;
+        uint64_t before13 = allocationCounter().allocations;
+        for (int i = 0; i < 100000; ++i) bulk13.insert(100000 - i);
+        assert(allocationCounter().allocations - before13 < 300 && "Test 13 Failed: bulk lazy insert not linear");
+
+        // Melds splice pending lists without copying them: 1000 melds of trees
+        // with 50 pending keys each allocate one list node per meld
+        vector<LazyLeftistTree<int, less<int>, CountingAllocator<int>>> parts13(1000);
+        for (size_t p = 0; p < parts13.size(); ++p) {
+            for (int i = 0; i < 50; ++i) parts13[p].insert(static_cast<int>(p * 50 + i));
+        }
+        before13 = allocationCounter().allocations;
+        for (auto& part : parts13) bulk13.mergeWith(part);
+        assert(allocationCounter().allocations - before13 <= parts13.size() && "Test 13 Failed: lazy meld copied");
+        assert(bulk13.size() == 150000 && bulk13.getMin() == 0 && "Test 13 Failed: lazy melds");
+        int previous13 = -1;
+        for (int i = 0; i < 150000; ++i) {
+            int key = bulk13.extractMin();
+            assert(key >= previous13 && "Test 13 Failed: order after lazy melds");
+            previous13 = key;
+        }
+    }
+    cout << "Test 13 Passed." << endl;
+
+    // Test 14: Batch extraction and sorted drain
+    LeftistTree<int> lt14;
+    for (int key : {9, 2, 7, 4, 5, 1, 8}) lt14.insert(key);
+    int buffer14[4];
+    assert(lt14.extractMinBatch(3, buffer14) == 3 && "Test 14 Failed: extractMinBatch count");
+    assert(buffer14[0] == 1 && buffer14[1] == 2 && buffer14[2] == 4 && "Test 14 Failed: extractMinBatch order");
+    assert(lt14.getMin() == 5 && "Test 14 Failed: getMin after batch");
+    vector<int> rest14;
+    assert(lt14.drainSorted(back_inserter(rest14)) == 4 && lt14.isEmpty() && "Test 14 Failed: drainSorted count");
+    assert((rest14 == vector<int>{5, 7, 8, 9}) && "Test 14 Failed: drainSorted order");
+    assert(lt14.extractMinBatch(8, buffer14) == 0 && "Test 14 Failed: extractMinBatch on empty heap");
+    size_t slabs14 = lt14.getPool()->slabCount();
+    for (int i = 0; i < 7; ++i) lt14.insert(i);
+    assert(lt14.getPool()->slabCount() == slabs14 && "Test 14 Failed: batch-freed nodes not reused");
+    struct FailingSlot { // Output whose third write throws
+        int* writes;
+        FailingSlot& operator=(int) {
+            if (++*writes == 3) throw runtime_error("output full");
+            return *this;
+        }
+    };
+    int writes14 = 0;
+    FailingSlot slots14[7] = {{&writes14}, {&writes14}, {&writes14}, {&writes14}, {&writes14}, {&writes14}, {&writes14}};
+    bool threw14 = false;
+    try {
+        lt14.extractMinBatch(7, slots14);
+    } catch (const runtime_error&) {
+        threw14 = true;
+    }
+    assert(threw14 && lt14.size() == 5 && lt14.getMin() == 2 && "Test 14 Failed: size after throwing output");
+    for (int i = 0; i < 2; ++i) lt14.insert(10 + i);
+    assert(lt14.getPool()->slabCount() == slabs14 && "Test 14 Failed: nodes lost to throwing output");
+    assert(lt14.drainSorted(back_inserter(rest14)) == 7 && "Test 14 Failed: drain after throwing output");
+    cout << "Test 14 Passed." << endl;
+
+    // Test 15: Compact index-based layout
+    static_assert(CompactArena<int>::bytesPerNode() < sizeof(Node<int>), "Compact node is not smaller");
+    static_assert(is_nothrow_move_constructible<CompactLeftistTree<int>>::value &&
+                      !is_copy_constructible<CompactLeftistTree<int>>::value &&
+                      !is_copy_assignable<CompactLeftistTree<int>>::value,
+                  "CompactLeftistTree must be nothrow-movable and not copyable");
+    CompactLeftistTree<int> compact1, compact2;
+    vector<int> model15;
+    mt19937 rng15(15);
+    for (int i = 0; i < 2000; ++i) {
+        int key = static_cast<int>(rng15() % 500);
+        (i % 2 ? compact1 : compact2).insert(key);
+        model15.push_back(key);
+    }
+    compact1.mergeWith(compact2); // Different arenas: copied over
+    assert(compact2.isEmpty() && "Test 15 Failed: source not emptied by mergeWith");
+    shared_ptr<CompactArena<int>> arena15 = compact1.getArena();
+    CompactLeftistTree<int> compact3(arena15);
+    compact3.insert(-5);
+    compact1.mergeWith(compact3); // Shared arena: melded in place
+    model15.push_back(-5);
+    sort(model15.begin(), model15.end());
+    vector<int> drained15;
+    while (!compact1.isEmpty()) drained15.push_back(compact1.extractMin());
+    assert(drained15 == model15 && "Test 15 Failed: compact drain order");
+    CompactLeftistTree<int> moved15a(arena15);
+    moved15a.insert(3);
+    moved15a.insert(1);
+    CompactLeftistTree<int> moved15b(std::move(moved15a));
+    assert(moved15a.isEmpty() && moved15b.size() == 2 && moved15b.getMin() == 1 && "Test 15 Failed: move");
+    moved15a.insert(7); // Moved-from tree stays usable on the shared arena
+    moved15b = std::move(moved15a);
+    assert(moved15a.isEmpty() && moved15b.size() == 1 && moved15b.extractMin() == 7 && "Test 15 Failed: move assign");
+    try {
+        compact1.getMin();
+        assert(false && "Test 15 Failed: getMin on empty compact tree did not throw");
+    } catch (const runtime_error&) {
+    }
+    cout << "Test 15 Passed." << endl;
+
+    // Test 16: Concurrent producers publishing local heaps while consumers pop
+    ConcurrentLeftistTree<int> shared16;
+    const int producers16 = 4, perProducer16 = 5000;
+    atomic<int> produced16(0);
+    vector<vector<int>> consumed16(2);
+    vector<thread> threads16;
+    for (int p = 0; p < producers16; ++p) {
+        threads16.emplace_back([&, p] {
+            LeftistTree<int> local;
+            for (int i = 0; i < perProducer16; ++i) {
+                local.insert(p * perProducer16 + i);
+                if (i % 100 == 99) shared16.publish(local);
+            }
+            shared16.publish(local);
+            produced16.fetch_add(perProducer16);
+        });
+    }
+    for (int c = 0; c < 2; ++c) {
+        threads16.emplace_back([&, c] {
+            int buffer[64];
+            while (true) {
+                bool done = produced16.load() == producers16 * perProducer16;
+                size_t popped = shared16.tryExtractMinBatch(64, buffer);
+                consumed16[c].insert(consumed16[c].end(), buffer, buffer + popped);
+                if (popped == 0 && done) break;
+                if (popped == 0) this_thread::yield();
+            }
+        });
+    }
+    for (thread& t : threads16) t.join();
+    vector<int> all16 = consumed16[0];
+    all16.insert(all16.end(), consumed16[1].begin(), consumed16[1].end());
+    sort(all16.begin(), all16.end());
+    assert(all16.size() == size_t(producers16 * perProducer16) && "Test 16 Failed: elements lost or duplicated");
+    for (size_t i = 0; i < all16.size(); ++i) {
+        assert(all16[i] == static_cast<int>(i) && "Test 16 Failed: wrong element consumed");
+    }
+    shared16.insert(3);
+    int single16 = 0;
+    assert(shared16.tryExtractMin(single16) && single16 == 3 && !shared16.tryExtractMin(single16) && "Test 16 Failed: tryExtractMin");
+    cout << "Test 16 Passed." << endl;
+
+    // Test 17: Sharded heap with relaxed ordering
+    ShardedLeftistHeap<int> sharded17(8);
+    RankErrorMeter meter17(100000);
+    mt19937 rng17(17);
+    vector<int> keys17;
+    for (int i = 0; i < 20000; ++i) {
+        int key = static_cast<int>(rng17() % 100000);
+        keys17.push_back(key);
+        sharded17.insert(key);
+        meter17.pushed(key);
+    }
+    vector<int> popped17;
+    int key17 = 0;
+    while (sharded17.tryExtractMin(key17)) {
+        popped17.push_back(key17);
+        meter17.popped(key17);
+    }
+    sort(keys17.begin(), keys17.end());
+    sort(popped17.begin(), popped17.end());
+    assert(popped17 == keys17 && "Test 17 Failed: sharded heap lost or duplicated keys");
+    assert(meter17.meanRankError() < 8 * 4 && "Test 17 Failed: rank error far above shard count");
+
+    ShardedLeftistHeap<int> strict17(1); // One shard is an exact heap
+    RankErrorMeter exact17(10);
+    for (int key : {5, 1, 3}) { strict17.insert(key); exact17.pushed(key); }
+    while (strict17.tryExtractMin(key17)) exact17.popped(key17);
+    assert(exact17.maxRankError() == 0 && "Test 17 Failed: single shard is not exact");
+
+    // Rebalancing must allocate from the shards' (stateful) allocator only
+    {
+        using Shards17 = ShardedLeftistHeap<int, less<int>, TaggedAllocator<int>>;
+        Shards17 tagged17(2, less<int>(), TaggedAllocator<int>(1));
+        Shards17::Tree local17(less<int>(), TaggedAllocator<int>(1));
+        for (int i = 0; i < 1000; ++i) local17.insert(999 - i);
+        tagged17.publish(local17); // All keys in one shard, so pops keep refilling the other
+        uint64_t defaultBefore17 = taggedAllocations()[0];
+        vector<int> drained17;
+        while (tagged17.tryExtractMin(key17)) drained17.push_back(key17);
+        sort(drained17.begin(), drained17.end());
+        assert(drained17.size() == 1000 && drained17.front() == 0 && drained17.back() == 999 &&
+               "Test 17 Failed: tagged shards lost keys");
+        assert(taggedAllocations()[0] == defaultBefore17 && "Test 17 Failed: rebalance used a default allocator");
+    }
+    cout << "Test 17 Passed." << endl;
+
+    // Test 18: Parallel meld of many heaps
+    for (unsigned threads18 : {1u, 4u}) {
+        vector<unique_ptr<LeftistTree<int>>> heaps18;
+        vector<LeftistTree<int>*> targets18;
+        vector<int> model18;
+        mt19937 rng18(18);
+        for (int h = 0; h < 300; ++h) {
+            heaps18.push_back(make_unique<LeftistTree<int>>());
+            targets18.push_back(heaps18.back().get());
+            for (int i = h % 7; i < 20; ++i) {
+                int key = static_cast<int>(rng18() % 10000);
+                heaps18.back()->insert(key);
+                model18.push_back(key);
+            }
+        }
+        targets18.push_back(nullptr);
+        targets18.push_back(targets18[5]); // Duplicate entries are melded once
+        LeftistTree<int>::meldAll(targets18, threads18);
+        for (size_t h = 1; h < heaps18.size(); ++h) {
+            assert(heaps18[h]->isEmpty() && "Test 18 Failed: source heap not emptied");
+        }
+        sort(model18.begin(), model18.end());
+        vector<int> drained18;
+        heaps18[0]->drainSorted(back_inserter(drained18));
+        assert(drained18 == model18 && "Test 18 Failed: meldAll contents incorrect");
+    }
+    cout << "Test 18 Passed." << endl;
+
+    // Test 19: Hot-path counters (checked only in builds with LEFTIST_TREE_STATS=1)
+    resetLeftistTreeStats();
+    {
+        LeftistTree<int> lt19;
+        for (int i = 0; i < 3000; ++i) lt19.insert(i % 2 ? i : -i);
+        for (int i = 0; i < 1000; ++i) lt19.extractMin();
+    }
+#if LEFTIST_TREE_STATS
+    {
+        const LeftistTreeStats& stats19 = leftistTreeStats();
+        assert(stats19.nodeAllocations == 3000 && stats19.nodeFrees == 1000 && "Test 19 Failed: allocation counters");
+        assert(stats19.peakLiveNodes == 3000 && "Test 19 Failed: peak live nodes");
+        uint64_t histogramTotal = 0;
+        for (uint64_t count : stats19.mergePathLength) histogramTotal += count;
+        assert(histogramTotal == stats19.merges && stats19.merges > 0 && "Test 19 Failed: merge path histogram");
+        uint64_t samples = 0;
+        for (uint64_t count : stats19.latency[LeftistTreeStats::Insert]) samples += count;
+        assert(samples == 2 && "Test 19 Failed: latency sampling");
+    }
+#else
+    static_assert(is_empty<SampledOpTimer>::value, "Disabled op timer must be empty");
+    assert(leftistTreeStats().merges == 0 && "Test 19 Failed: counters move while disabled");
+#endif
+    cout << "Test 19 Passed." << endl;
+
+    // Test 20: size() and right-spine queries
+    AddressableLeftistTree<int> lt20a, lt20b;
+    assert(lt20a.size() == 0 && lt20a.rootNPL() == -1 && lt20a.rightSpineLength() == 0 && "Test 20 Failed: empty tree stats");
+    vector<AddressableLeftistTree<int>::Handle> handles20;
+    for (int i = 0; i < 1000; ++i) handles20.push_back(lt20a.insert(i));
+    for (int i = 0; i < 500; ++i) lt20b.insert(i);
+    assert(lt20a.size() == 1000 && "Test 20 Failed: size after inserts");
+    lt20a.erase(handles20[500]);
+    lt20a.extractMin();
+    int buffer20[10];
+    lt20a.extractMinBatch(10, buffer20);
+    assert(lt20a.size() == 988 && "Test 20 Failed: size after erase and extracts");
+    lt20a.mergeWith(lt20b);
+    assert(lt20a.size() == 1488 && lt20b.size() == 0 && "Test 20 Failed: size moved by mergeWith");
+    size_t spine20 = lt20a.rightSpineLength();
+    assert(spine20 >= 1 && (size_t(1) << spine20) <= lt20a.size() + 1 && "Test 20 Failed: right spine bound");
+    assert(lt20a.rootNPL() == static_cast<int>(spine20) - 1 && "Test 20 Failed: rootNPL");
+    lt20a.assign(batch.begin(), batch.end());
+    assert(lt20a.size() == batch.size() && "Test 20 Failed: size after assign");
+    lt20a.clear();
+    assert(lt20a.size() == 0 && lt20a.isEmpty() && "Test 20 Failed: size after clear");
+
+    LazyLeftistTree<int> lazy20a, lazy20b;
+    for (int i = 0; i < 10; ++i) lazy20a.insert(i);
+    lazy20b.insert(-1);
+    lazy20a.mergeWith(lazy20b);
+    assert(lazy20a.size() == 11 && lazy20b.size() == 0 && "Test 20 Failed: lazy size with pending heaps");
+    lazy20a.extractMin();
+    assert(lazy20a.size() == 10 && "Test 20 Failed: lazy size after extract");
+
+    vector<LeftistTree<int>*> meld20;
+    vector<unique_ptr<LeftistTree<int>>> owned20;
+    for (int h = 0; h < 5; ++h) {
+        owned20.push_back(make_unique<LeftistTree<int>>());
+        for (int i = 0; i <= h; ++i) owned20.back()->insert(i);
+        meld20.push_back(owned20.back().get());
+    }
+    LeftistTree<int>::meldAll(meld20, 1);
+    assert(owned20[0]->size() == 15 && owned20[4]->size() == 0 && "Test 20 Failed: size after meldAll");
+    cout << "Test 20 Passed." << endl;
+
+    // Test 21: Heap images survive a restart
+    string image21 = (filesystem::temp_directory_path() / ("leftist_tree_test21_" + to_string(getpid()) + ".img")).string();
+    {
+        LeftistTree<int> source21;
+        vector<int> model21;
+        mt19937 rng21(21);
+        for (int i = 0; i < 2000; ++i) {
+            int key = static_cast<int>(rng21() % 5000) - 2500;
+            source21.insert(key);
+            model21.push_back(key);
+        }
+        source21.saveImage(image21);
+        sort(model21.begin(), model21.end());
+
+        auto mapped21 = CompactLeftistTree<int>::mapImage(image21);
+        assert(mapped21->isMapped() && mapped21->size() == 2000 && "Test 21 Failed: mapped size");
+        assert(mapped21->getMin() == model21.front() && "Test 21 Failed: mapped min");
+        for (int i = 0; i < 3000; ++i) mapped21->insert(i); // Grows the image
+        for (int i = 0; i < 100; ++i) mapped21->extractMin();
+        mapped21->flush();
+        mapped21.reset();
+        for (int i = 0; i < 3000; ++i) model21.push_back(i);
+        sort(model21.begin(), model21.end());
+        model21.erase(model21.begin(), model21.begin() + 100);
+
+        auto reopened21 = CompactLeftistTree<int>::mapImage(image21);
+        assert(reopened21->size() == model21.size() && "Test 21 Failed: size after reopen");
+        vector<int> drained21;
+        while (!reopened21->isEmpty()) drained21.push_back(reopened21->extractMin());
+        assert(drained21 == model21 && "Test 21 Failed: contents after reopen");
+    }
+    {
+        auto arena21 = make_shared<CompactArena<int>>();
+        CompactLeftistTree<int> shared21a(arena21), shared21b(arena21);
+        for (int i = 0; i < 50; ++i) { shared21a.insert(i); shared21b.insert(-i); }
+        shared21a.saveImage(image21);
+        auto mapped21 = CompactLeftistTree<int>::mapImage(image21);
+        int expected21 = 0;
+        while (!mapped21->isEmpty()) {
+            int key = mapped21->extractMin();
+            assert(key == expected21 && "Test 21 Failed: compact image");
+            ++expected21;
+        }
+        assert(expected21 == 50 && "Test 21 Failed: compact image size");
+    }
+    {
+        LeftistTree<double> wrong21;
+        wrong21.insert(1.0);
+        wrong21.saveImage(image21);
+        bool rejected21 = false;
+        try {
+            CompactLeftistTree<int>::mapImage(image21);
+        } catch (const runtime_error&) {
+            rejected21 = true;
+        }
+        assert(rejected21 && "Test 21 Failed: mismatched image accepted");
+    }
+    {
+        LeftistTree<int> small21;
+        for (int i = 0; i < 10; ++i) small21.insert(i);
+        // Root and free-list indices past the used records must be rejected
+        for (size_t field : {offsetof(LeftistImageHeader, root), offsetof(LeftistImageHeader, freeHead)}) {
+            small21.saveImage(image21);
+            {
+                fstream corrupt(image21, ios::binary | ios::in | ios::out);
+                uint32_t outOfRange = 10;
+                corrupt.seekp(static_cast<streamoff>(field));
+                corrupt.write(reinterpret_cast<const char*>(&outOfRange), sizeof(outOfRange));
+            }
+            bool rejected21 = false;
+            try {
+                CompactLeftistTree<int>::mapImage(image21);
+            } catch (const runtime_error&) {
+                rejected21 = true;
+            }
+            assert(rejected21 && "Test 21 Failed: corrupt header accepted");
+        }
+    }
+    filesystem::remove(image21);
+    cout << "Test 21 Passed." << endl;
+
+    // Test 22: Sorted drain range
+    LeftistTree<int> lt22;
+    vector<int> model22;
+    mt19937 rng22(22);
+    for (int i = 0; i < 5000; ++i) {
+        int key = static_cast<int>(rng22() % 1000);
+        lt22.insert(key);
+        model22.push_back(key);
+    }
+    sort(model22.begin(), model22.end());
+    static_assert(input_iterator<LeftistTree<int>::SortedDrain::iterator>, "drained() must give an input iterator");
+    vector<int> drained22;
+    for (int key : lt22.drained()) {
+        drained22.push_back(key);
+        if (drained22.size() == 1000) break;
+    }
+    // The key the loop broke at was never advanced past, so it is still in the tree
+    assert(lt22.size() == 4001 && lt22.getMin() == model22[999] && "Test 22 Failed: early stop keeps the rest");
+    drained22.pop_back();
+    for (int key : lt22.drained()) drained22.push_back(key);
+    assert(drained22 == model22 && lt22.isEmpty() && "Test 22 Failed: drained order");
+    LeftistTree<string> strings22;
+    for (const char* word : {"pear", "fig", "apple"}) strings22.insert(word);
+    vector<string> words22;
+    for (string& word : strings22.drained()) words22.push_back(std::move(word));
+    assert((words22 == vector<string>{"apple", "fig", "pear"}) && "Test 22 Failed: moving keys out");
+    for (int key : lt22.drained()) drained22.push_back(key); // Empty tree yields nothing
+    assert(drained22.size() == model22.size() && "Test 22 Failed: empty drain");
+    cout << "Test 22 Passed." << endl;
+
+    // Test 23: replaceTop and the k-way merger
+    LeftistTree<int> lt23;
+    vector<int> model23;
+    mt19937 rng23(23);
+    for (int i = 0; i < 500; ++i) {
+        int key = static_cast<int>(rng23() % 1000);
+        lt23.insert(key);
+        model23.push_back(key);
+    }
+    make_heap(model23.begin(), model23.end(), greater<int>());
+    for (int i = 0; i < 5000; ++i) {
+        int key = static_cast<int>(rng23() % 1200);
+        pop_heap(model23.begin(), model23.end(), greater<int>());
+        int expectedMin = model23.back();
+        model23.back() = key;
+        push_heap(model23.begin(), model23.end(), greater<int>());
+        assert(lt23.replaceTop(key) == expectedMin && "Test 23 Failed: replaceTop returned wrong min");
+        assert(lt23.getMin() == model23.front() && "Test 23 Failed: min after replaceTop");
+    }
+    assert(lt23.size() == 500 && lt23.rightSpineLength() <= 9 && "Test 23 Failed: shape after replaceTop");
+    AddressableLeftistTree<int> addressable23;
+    auto top23 = addressable23.insert(1);
+    auto other23 = addressable23.insert(5);
+    addressable23.insert(9);
+    assert(addressable23.replaceTop(7) == 1 && *top23 == 7 && "Test 23 Failed: handle follows the reused root");
+    addressable23.decreaseKey(top23, 0);
+    addressable23.erase(other23);
+    assert(addressable23.extractMin() == 0 && addressable23.extractMin() == 9 && "Test 23 Failed: handles after replaceTop");
+
+    vector<vector<int>> runs23(300);
+    vector<int> expected23;
+    for (size_t r = 0; r < runs23.size(); ++r) {
+        size_t length = rng23() % 50; // Some runs are empty
+        for (size_t i = 0; i < length; ++i) runs23[r].push_back(static_cast<int>(rng23() % 2000));
+        sort(runs23[r].begin(), runs23[r].end());
+        expected23.insert(expected23.end(), runs23[r].begin(), runs23[r].end());
+    }
+    sort(expected23.begin(), expected23.end());
+    KWayMerger<int> merger23(7);
+    for (vector<int>& run : runs23) {
+        size_t position = 0;
+        merger23.addRun([&run, position](int* buffer, size_t capacity) mutable {
+            size_t n = min(capacity, run.size() - position);
+            copy_n(run.begin() + position, n, buffer);
+            position += n;
+            return n;
+        });
+    }
+    vector<int> merged23;
+    int block23[13];
+    while (size_t n = merger23.read(block23, 13)) merged23.insert(merged23.end(), block23, block23 + n);
+    assert(merged23 == expected23 && merger23.isDone() && "Test 23 Failed: k-way merge output");
+
+    using Tagged23 = pair<int, int>; // (key, run), ordered by key only
+    auto byKey23 = [](const Tagged23& a, const Tagged23& b) { return a.first < b.first; };
+    KWayMerger<Tagged23, decltype(byKey23)> stable23(2, byKey23);
+    for (int r = 0; r < 4; ++r) {
+        stable23.addRun([r, emitted = 0](Tagged23* buffer, size_t) mutable {
+            if (emitted == 3) return size_t(0);
+            buffer[0] = Tagged23(emitted++, r);
+            return size_t(1);
+        });
+    }
+    Tagged23 stableOut23[12];
+    assert(stable23.read(stableOut23, 12) == 12 && "Test 23 Failed: stable merge size");
+    for (int i = 0; i < 12; ++i) {
+        assert(stableOut23[i] == Tagged23(i / 4, i % 4) && "Test 23 Failed: equal keys not in run order");
+    }
+    cout << "Test 23 Passed." << endl;
+
+    // Test 24: pushPop
+    LeftistTree<int> lt24;
+    assert(lt24.pushPop(4) == 4 && lt24.isEmpty() && "Test 24 Failed: pushPop on empty heap");
+    for (int key : {10, 20, 30}) lt24.insert(key);
+    size_t spine24 = lt24.rightSpineLength();
+    assert(lt24.pushPop(10) == 10 && lt24.pushPop(3) == 3 && "Test 24 Failed: key at or below min returned");
+    assert(lt24.size() == 3 && lt24.getMin() == 10 && lt24.rightSpineLength() == spine24 && "Test 24 Failed: heap changed");
+    assert(lt24.pushPop(25) == 10 && lt24.getMin() == 20 && "Test 24 Failed: pushPop above min");
+    assert(lt24.pushPop(40) == 20 && lt24.pushPop(50) == 25 && lt24.size() == 3 && "Test 24 Failed: pushPop sequence");
+    LazyLeftistTree<int> lazy24;
+    for (int key : {8, 6, 7}) lazy24.insert(key);
+    assert(lazy24.pushPop(5) == 5 && lazy24.replaceTop(9) == 6 && lazy24.extractMin() == 7 && "Test 24 Failed: lazy hold ops");
+    cout << "Test 24 Passed." << endl;
+
+    // Test 25: Weight-biased policy
+    WeightBiasedLeftistTree<int> wb25a, wb25b;
+    multiset<int> model25;
+    mt19937 rng25(25);
+    for (int i = 0; i < 4000; ++i) {
+        int key = static_cast<int>(rng25() % 3000);
+        (i % 3 ? wb25a : wb25b).insert(key);
+        model25.insert(key);
+    }
+    wb25a.mergeWith(wb25b);
+    assert(wb25a.size() == model25.size() && wb25b.isEmpty() && "Test 25 Failed: weight-biased meld size");
+    assert((size_t(1) << wb25a.rightSpineLength()) <= wb25a.size() + 1 && "Test 25 Failed: weight-biased spine bound");
+    for (int i = 0; i < 2000; ++i) {
+        if (i % 2) {
+            int key = static_cast<int>(rng25() % 3000);
+            assert(wb25a.replaceTop(key) == *model25.begin() && "Test 25 Failed: weight-biased replaceTop");
+            model25.erase(model25.begin());
+            model25.insert(key);
+        } else {
+            assert(wb25a.extractMin() == *model25.begin() && "Test 25 Failed: weight-biased extractMin");
+            model25.erase(model25.begin());
+        }
+    }
+    WeightBiasedLeftistTree<int> wb25c(batch.begin(), batch.end());
+    model25.insert(batch.begin(), batch.end());
+    vector<WeightBiasedLeftistTree<int>*> meld25 = {&wb25a, &wb25c};
+    WeightBiasedLeftistTree<int>::meldAll(meld25, 2);
+    assert((size_t(1) << wb25a.rightSpineLength()) <= wb25a.size() + 1 && "Test 25 Failed: spine bound after meldAll");
+    vector<int> drained25;
+    for (int key : wb25a.drained()) drained25.push_back(key);
+    assert(equal(drained25.begin(), drained25.end(), model25.begin(), model25.end()) && "Test 25 Failed: weight-biased order");
+    cout << "Test 25 Passed." << endl;
+
+    // Test 26: Skew policy
+    static_assert(sizeof(Node<long long, false, Skew>) < sizeof(Node<long long, false, HeightBiased>), "Skew nodes drop the npl");
+    SkewHeap<int> skew26a, skew26b(batch.begin(), batch.end());
+    multiset<int> model26(batch.begin(), batch.end());
+    mt19937 rng26(26);
+    for (int i = 0; i < 3000; ++i) {
+        int key = static_cast<int>(rng26() % 2000);
+        skew26a.insert(key);
+        model26.insert(key);
+    }
+    for (int i = 0; i < 500; ++i) {
+        int key = skew26a.extractMin();
+        assert(key <= skew26a.getMin() && "Test 26 Failed: skew extractMin order");
+    }
+    skew26a.mergeWith(skew26b);
+    assert(skew26a.pushPop(-1) == -1 && skew26a.size() == model26.size() - 500 && "Test 26 Failed: skew size");
+    vector<int> drained26;
+    skew26a.drainSorted(back_inserter(drained26));
+    assert(is_sorted(drained26.begin(), drained26.end()) && drained26.size() == model26.size() - 500 &&
+           "Test 26 Failed: skew drain");
+    assert(includes(model26.begin(), model26.end(), drained26.begin(), drained26.end()) && "Test 26 Failed: skew contents");
+    cout << "Test 26 Passed." << endl;
+
+    // Test 27: Persistent heap versions
+    {
+        PersistentLeftistHeap<int> base27;
+        multiset<int> baseModel27;
+        mt19937 rng27(27);
+        for (int i = 0; i < 3000; ++i) {
+            int key = static_cast<int>(rng27() % 5000);
+            base27.insert(key);
+            baseModel27.insert(key);
+        }
+        PersistentLeftistHeap<int> fork27 = base27;
+        assert(fork27.sharesRootWith(base27) && fork27.size() == 3000 && "Test 27 Failed: fork is not shared");
+        multiset<int> forkModel27 = baseModel27;
+        for (int i = 0; i < 2000; ++i) {
+            if (i % 3 == 0) {
+                int key = static_cast<int>(rng27() % 5000);
+                fork27.insert(key);
+                forkModel27.insert(key);
+            } else {
+                assert(fork27.extractMin() == *forkModel27.begin() && "Test 27 Failed: fork extractMin");
+                forkModel27.erase(forkModel27.begin());
+            }
+        }
+        PersistentLeftistHeap<int> other27;
+        for (int key : {-5, 7, 7}) other27.insert(key);
+        fork27.mergeWith(other27);
+        forkModel27.insert({-5, 7, 7});
+        assert(other27.size() == 3 && other27.getMin() == -5 && "Test 27 Failed: mergeWith changed its argument");
+
+        PersistentLeftistHeap<int> baseCopy27 = base27;
+        vector<int> baseDrained27;
+        while (!baseCopy27.isEmpty()) baseDrained27.push_back(baseCopy27.extractMin());
+        assert(equal(baseDrained27.begin(), baseDrained27.end(), baseModel27.begin(), baseModel27.end()) &&
+               base27.size() == 3000 && "Test 27 Failed: base version changed");
+        vector<int> forkDrained27;
+        while (!fork27.isEmpty()) forkDrained27.push_back(fork27.extractMin());
+        assert(equal(forkDrained27.begin(), forkDrained27.end(), forkModel27.begin(), forkModel27.end()) &&
+               "Test 27 Failed: fork contents");
+
+        PersistentLeftistHeap<int> doubled27 = other27;
+        doubled27.mergeWith(doubled27);
+        assert(doubled27.size() == 6 && doubled27.extractMin() == -5 && doubled27.extractMin() == -5 &&
+               "Test 27 Failed: self merge");
+        base27 = std::move(doubled27);
+        assert(base27.size() == 4 && base27.getMin() == 7 && "Test 27 Failed: move assignment");
+    }
+    {
+        PersistentLeftistHeap<string> words27;
+        for (const char* word : {"kiwi", "apple", "mango"}) words27.insert(word);
+        PersistentLeftistHeap<string> branch27(words27);
+        branch27.insert("banana");
+        assert(branch27.extractMin() == "apple" && branch27.extractMin() == "banana" && "Test 27 Failed: string fork");
+        assert(words27.size() == 3 && words27.getMin() == "apple" && "Test 27 Failed: string base changed");
+    }
+    cout << "Test 27 Passed." << endl;
+
+    // Test 28: Moving and cloning trees
+    static_assert(is_nothrow_move_constructible<LeftistTree<int>>::value && !is_copy_constructible<LeftistTree<int>>::value,
+                  "LeftistTree must be nothrow-movable and not implicitly copyable");
+    using FunctionCompare28 = function<bool(int, int)>;
+    static_assert(is_move_constructible<LeftistTree<int, FunctionCompare28>>::value &&
+                      !is_nothrow_move_constructible<LeftistTree<int, FunctionCompare28>>::value &&
+                      !is_nothrow_move_constructible<CompactLeftistTree<int, FunctionCompare28>>::value,
+                  "Moves copy the comparator, so a throwing copy must not be noexcept");
+    {
+        LeftistTree<int, FunctionCompare28> from28([](int a, int b) { return a < b; });
+        from28.insert(2);
+        LeftistTree<int, FunctionCompare28> to28(std::move(from28));
+        from28.insert(1); // The moved-from tree still has its comparator
+        from28.insert(0);
+        assert(to28.getMin() == 2 && from28.getMin() == 0 && "Test 28 Failed: comparator lost in move");
+    }
+    vector<LeftistTree<int>> shards28;
+    for (int h = 0; h < 100; ++h) { // Relocates the trees several times
+        shards28.emplace_back();
+        for (int i = 0; i < 20; ++i) shards28.back().insert(h * 100 + i);
+    }
+    for (int h = 0; h < 100; ++h) {
+        assert(shards28[h].size() == 20 && shards28[h].getMin() == h * 100 && "Test 28 Failed: trees after relocation");
+    }
+    LeftistTree<int> moved28 = std::move(shards28[0]);
+    assert(moved28.size() == 20 && shards28[0].isEmpty() && shards28[0].size() == 0 && "Test 28 Failed: move construction");
+    shards28[0].insert(-1); // A moved-from tree stays usable
+    moved28 = std::move(shards28[1]);
+    assert(moved28.getMin() == 100 && shards28[0].getMin() == -1 && "Test 28 Failed: move assignment");
+
+    LeftistTree<int> original28(batch.begin(), batch.end());
+    original28.extractMin();
+    LeftistTree<int> clone28 = original28.clone();
+    assert(clone28.size() == original28.size() && clone28.rootNPL() == original28.rootNPL() && "Test 28 Failed: clone shape");
+    clone28.insert(-100);
+    assert(original28.getMin() != -100 && "Test 28 Failed: clone shares nodes");
+    clone28.extractMin();
+    vector<int> fromOriginal28, fromClone28;
+    original28.drainSorted(back_inserter(fromOriginal28));
+    clone28.drainSorted(back_inserter(fromClone28));
+    assert(fromOriginal28 == fromClone28 && "Test 28 Failed: clone contents");
+    assert(LeftistTree<int>().clone().isEmpty() && "Test 28 Failed: clone of empty tree");
+
+    AddressableLeftistTree<string> words28;
+    for (const char* word : {"plum", "date", "lime", "fig"}) words28.insert(word);
+    AddressableLeftistTree<string> wordsClone28 = words28.clone();
+    auto handle28 = wordsClone28.insert("cherry");
+    wordsClone28.decreaseKey(handle28, "apricot");
+    assert(wordsClone28.extractMin() == "apricot" && wordsClone28.extractMin() == "date" && "Test 28 Failed: addressable clone");
+    assert(words28.size() == 4 && words28.getMin() == "date" && "Test 28 Failed: addressable original");
+    cout << "Test 28 Passed." << endl;
+
+    // Test 29: Batch insert
+    LeftistTree<int> lt29;
+    multiset<int> model29;
+    for (int i = 0; i < 100; ++i) { lt29.insert(i * 7 % 50); model29.insert(i * 7 % 50); }
+    vector<int> ascending29(1000), shuffled29(1000);
+    iota(ascending29.begin(), ascending29.end(), -300);
+    iota(shuffled29.begin(), shuffled29.end(), 0);
+    shuffle(shuffled29.begin(), shuffled29.end(), mt19937(29));
+    size_t spineBefore29 = lt29.rightSpineLength();
+    lt29.insertBatch(ascending29);
+    assert(lt29.rightSpineLength() <= spineBefore29 + 1 && lt29.getMin() == -300 && "Test 29 Failed: sorted batch spine");
+    lt29.insertBatch(shuffled29);
+    lt29.insertBatch(span<const int>());
+    model29.insert(ascending29.begin(), ascending29.end());
+    model29.insert(shuffled29.begin(), shuffled29.end());
+    assert(lt29.size() == model29.size() && "Test 29 Failed: batch size");
+    vector<int> drained29;
+    lt29.drainSorted(back_inserter(drained29));
+    assert(equal(drained29.begin(), drained29.end(), model29.begin(), model29.end()) && "Test 29 Failed: batch contents");
+    WeightBiasedLeftistTree<int> wb29;
+    wb29.insertBatch(shuffled29);
+    wb29.insertBatch(ascending29);
+    for (int i = 0; i < 300; ++i) assert(wb29.extractMin() == i - 300 && "Test 29 Failed: weight-biased batch");
+    assert((size_t(1) << wb29.rightSpineLength()) <= wb29.size() + 1 && "Test 29 Failed: weight-biased batch weights");
+    AddressableLeftistTree<int> addressable29;
+    auto handle29 = addressable29.insert(5000);
+    addressable29.insertBatch(shuffled29);
+    addressable29.decreaseKey(handle29, -1);
+    assert(addressable29.extractMin() == -1 && addressable29.extractMin() == 0 && "Test 29 Failed: addressable batch");
+    cout << "Test 29 Passed." << endl;
+
+    // Test 30: Compacting a churned tree
+    LeftistTree<int> lt30;
+    multiset<int> model30;
+    mt19937 rng30(30);
+    for (int i = 0; i < 5000; ++i) { int key = static_cast<int>(rng30() % 10000); lt30.insert(key); model30.insert(key); }
+    for (int i = 0; i < 20000; ++i) {
+        int key = static_cast<int>(rng30() % 10000);
+        model30.erase(model30.begin());
+        model30.insert(key);
+        lt30.extractMin();
+        lt30.insert(key);
+    }
+    int npl30 = lt30.rootNPL();
+    auto oldPool30 = lt30.getPool();
+    lt30.compact();
+    assert(lt30.getPool() != oldPool30 && lt30.rootNPL() == npl30 && lt30.size() == model30.size() &&
+           "Test 30 Failed: compact shape");
+    oldPool30.reset();
+    for (int i = 0; i < 100; ++i) { lt30.insert(-i); model30.insert(-i); }
+    vector<int> drained30;
+    lt30.drainSorted(back_inserter(drained30));
+    assert(equal(drained30.begin(), drained30.end(), model30.begin(), model30.end()) && "Test 30 Failed: compact contents");
+
+    auto sharedPool30 = make_shared<LeftistTree<string>::Pool>();
+    LeftistTree<string> words30(sharedPool30), neighbour30(sharedPool30);
+    for (const char* word : {"oak", "ash", "elm", "yew"}) { words30.insert(word); neighbour30.insert(word); }
+    words30.compact();
+    assert(words30.extractMin() == "ash" && words30.size() == 3 && neighbour30.getMin() == "ash" &&
+           "Test 30 Failed: compact with a shared pool");
+    neighbour30.mergeWith(words30);
+    assert(neighbour30.size() == 7 && words30.isEmpty() && "Test 30 Failed: meld after compact");
+    cout << "Test 30 Passed." << endl;
+
+    // Test 31: Double-ended heap
+    DoubleEndedLeftistHeap<int> deque31;
+    multiset<int> model31;
+    mt19937 rng31(31);
+    for (int i = 0; i < 6000; ++i) {
+        int key = static_cast<int>(rng31() % 1000);
+        switch (rng31() % 4) {
+        case 0:
+        case 1:
+            deque31.insert(key);
+            model31.insert(key);
+            break;
+        case 2:
+            if (!model31.empty()) {
+                assert(deque31.extractMin() == *model31.begin() && "Test 31 Failed: extractMin");
+                model31.erase(model31.begin());
+            }
+            break;
+        default:
+            if (!model31.empty()) {
+                assert(deque31.getMax() == *model31.rbegin() && deque31.extractMax() == *model31.rbegin() &&
+                       "Test 31 Failed: extractMax");
+                model31.erase(prev(model31.end()));
+            }
+        }
+        assert(deque31.size() == model31.size() && (model31.empty() || deque31.getMin() == *model31.begin()) &&
+               "Test 31 Failed: size and min");
+    }
+
+    DoubleEndedLeftistHeap<int> bounded31(100);
+    multiset<int> kept31;
+    for (int i = 0; i < 5000; ++i) {
+        int key = static_cast<int>(rng31() % 100000);
+        optional<int> dropped = bounded31.pushEvicting(key);
+        kept31.insert(key);
+        if (kept31.size() > 100) {
+            assert(dropped && *dropped == *kept31.rbegin() && "Test 31 Failed: evicted key");
+            kept31.erase(prev(kept31.end()));
+        } else {
+            assert(!dropped && "Test 31 Failed: eviction below capacity");
+        }
+    }
+    assert(bounded31.size() == 100 && bounded31.getMax() == *kept31.rbegin() && "Test 31 Failed: bounded max");
+    vector<int> drained31;
+    while (!bounded31.isEmpty()) drained31.push_back(bounded31.extractMin());
+    assert(equal(drained31.begin(), drained31.end(), kept31.begin(), kept31.end()) && "Test 31 Failed: bounded contents");
+
+    DoubleEndedLeftistHeap<string> words31(2);
+    for (const char* word : {"pear", "fig", "apple", "kiwi"}) words31.pushEvicting(word);
+    assert(words31.extractMax() == "fig" && words31.extractMax() == "apple" && words31.isEmpty() &&
+           "Test 31 Failed: string eviction");
+    cout << "Test 31 Passed." << endl;
+
+    // Test 32: Bounded top-K
+    BoundedTopK<int> top32(50);
+    vector<int> stream32(20000);
+    mt19937 rng32(32);
+    for (int& key : stream32) key = static_cast<int>(rng32() % 100000);
+    size_t filled32 = 0;
+    for (size_t i = 0; i < stream32.size(); ++i) {
+        top32.offer(stream32[i]);
+        if (i == 49) filled32 = top32.size();
+    }
+    assert(filled32 == 50 && top32.isFull() && "Test 32 Failed: fill to capacity");
+    vector<int> expected32 = stream32;
+    partial_sort(expected32.begin(), expected32.begin() + 50, expected32.end());
+    expected32.resize(50);
+    assert(top32.threshold() == expected32.back() && "Test 32 Failed: threshold");
+    assert(!top32.offer(expected32.back() + 1) && "Test 32 Failed: key outside top K accepted");
+    vector<int> kept32;
+    assert(top32.drainSorted(back_inserter(kept32)) == 50 && kept32 == expected32 && "Test 32 Failed: kept keys");
+    BoundedTopK<int> none32(0);
+    assert(!none32.offer(1) && none32.size() == 0 && "Test 32 Failed: k = 0");
+    BoundedTopK<string, greater<string>> largest32(2);
+    for (const char* word : {"b", "d", "a", "c"}) largest32.offer(word);
+    vector<string> words32;
+    largest32.drainSorted(back_inserter(words32));
+    assert((words32 == vector<string>{"d", "c"}) && "Test 32 Failed: custom order");
+#if LEFTIST_TREE_STATS
+    resetLeftistTreeStats();
+    {
+        BoundedTopK<int> counted32(64);
+        for (int key : stream32) counted32.offer(key);
+        assert(leftistTreeStats().nodeAllocations == 64 + 64 && "Test 32 Failed: allocations beyond k nodes");
+    }
+#endif
+    cout << "Test 32 Passed." << endl;
+
+    // Test 33: Awaitable queue
+    {
+        AsyncLeftistQueue<int> queue33;
+        vector<int> got33;
+        auto consume33 = [](AsyncLeftistQueue<int>& queue, vector<int>& got, int pops) -> DetachedTask {
+            for (int i = 0; i < pops; ++i) {
+                got.push_back(co_await queue.pop());
+            }
+        };
+        queue33.insert(7);
+        queue33.insert(3);
+        consume33(queue33, got33, 2);
+        assert((got33 == vector<int>{3, 7}) && queue33.waiterCount() == 0 && "Test 33 Failed: ready pops");
+
+        got33.clear();
+        consume33(queue33, got33, 1);
+        assert(got33.empty() && queue33.waiterCount() == 1 && "Test 33 Failed: pop on empty did not suspend");
+        queue33.insert(42);
+        assert((got33 == vector<int>{42}) && queue33.isEmpty() && queue33.waiterCount() == 0 &&
+               "Test 33 Failed: insert did not resume waiter inline");
+
+        // Three single-pop consumers, one batch: each wakes once with the smallest keys
+        got33.clear();
+        for (int i = 0; i < 3; ++i) {
+            consume33(queue33, got33, 1);
+        }
+        vector<int> batch33 = {9, 4, 8, 1, 6, 2, 5};
+        queue33.insertBatch(batch33);
+        assert((got33 == vector<int>{1, 2, 4}) && queue33.size() == 4 && queue33.waiterCount() == 0 &&
+               "Test 33 Failed: batch wake");
+
+        // A consumer that keeps popping drains the rest without suspending, then waits
+        got33.clear();
+        consume33(queue33, got33, 6);
+        assert((got33 == vector<int>{5, 6, 8, 9}) && queue33.waiterCount() == 1 && "Test 33 Failed: drain then wait");
+        LeftistTree<int> other33;
+        other33.insert(11);
+        other33.insert(10);
+        queue33.mergeWith(other33);
+        assert((got33 == vector<int>{5, 6, 8, 9, 10, 11}) && other33.isEmpty() && queue33.waiterCount() == 0 &&
+               "Test 33 Failed: mergeWith resume");
+
+        // Consumers that re-await while being resumed queue behind the current batch
+        got33.clear();
+        consume33(queue33, got33, 2);
+        consume33(queue33, got33, 1);
+        queue33.insertBatch(vector<int>{30, 20});
+        assert((got33 == vector<int>{20, 30}) && queue33.waiterCount() == 1 && "Test 33 Failed: re-await ordering");
+        queue33.insert(40);
+        assert(got33.back() == 40 && queue33.waiterCount() == 0 && "Test 33 Failed: re-awaited consumer");
+
+        bool closedOut33 = false;
+        auto closing33 = [](AsyncLeftistQueue<int>& queue, bool& closedOut) -> DetachedTask {
+            try {
+                co_await queue.pop();
+            } catch (const runtime_error&) {
+                closedOut = true;
+            }
+        };
+        closing33(queue33, closedOut33);
+        queue33.close();
+        assert(closedOut33 && queue33.waiterCount() == 0 && "Test 33 Failed: close did not release waiter");
+        bool threw33 = false;
+        try {
+            queue33.insert(1);
+        } catch (const runtime_error&) {
+            threw33 = true;
+        }
+        assert(threw33 && "Test 33 Failed: insert after close");
+    }
+    cout << "Test 33 Passed." << endl;
+
+    // Test 34: Timer heap with an append buffer
+    {
+        TimerLeftistHeap<long long> timers34;
+        multiset<long long> model34;
+        mt19937 rng34(34);
+        long long now34 = 0;
+        vector<long long> polled34;
+        for (int tick = 0; tick < 2000; ++tick) {
+            now34 += 1 + static_cast<long long>(rng34() % 3);
+            for (int i = 0; i < 5; ++i) {
+                // Mostly now + constant timeout, sometimes a shorter one out of order
+                long long deadline = now34 + (rng34() % 8 == 0 ? static_cast<long long>(rng34() % 100) : 100);
+                timers34.insert(deadline);
+                model34.insert(deadline);
+            }
+            polled34.clear();
+            size_t count = timers34.pollExpired(now34, back_inserter(polled34));
+            assert(count == polled34.size() && is_sorted(polled34.begin(), polled34.end()) &&
+                   "Test 34 Failed: poll not sorted");
+            vector<long long> expected(model34.begin(), model34.upper_bound(now34));
+            model34.erase(model34.begin(), model34.upper_bound(now34));
+            assert(polled34 == expected && "Test 34 Failed: pollExpired keys");
+            assert(timers34.size() == model34.size() && "Test 34 Failed: size");
+        }
+        assert(timers34.appendedCount() > timers34.size() / 2 && "Test 34 Failed: in-order keys not buffered");
+        assert(timers34.getMin() == *model34.begin() && "Test 34 Failed: getMin");
+
+        TimerLeftistHeap<long long> other34;
+        for (long long key : {now34 + 500, now34 - 1, now34 + 500}) {
+            other34.insert(key);
+            model34.insert(key);
+        }
+        timers34.mergeWith(other34);
+        assert(other34.isEmpty() && timers34.size() == model34.size() && "Test 34 Failed: mergeWith");
+        timers34.meldAppends();
+        assert(timers34.appendedCount() == 0 && "Test 34 Failed: meldAppends");
+        for (long long expected : model34) {
+            long long key = timers34.extractMin();
+            assert(key == expected && "Test 34 Failed: extractMin order");
+        }
+        assert(timers34.isEmpty() && timers34.pollExpired(now34, back_inserter(polled34)) == 0 &&
+               "Test 34 Failed: drained");
+    }
+    cout << "Test 34 Passed." << endl;
+
+    // Test 35: Discrete-event simulation driver
+    {
+        EventSimulation<int> sim35;
+        vector<pair<double, int>> trace35;
+        sim35.scheduleAt(2.0, 1);
+        sim35.scheduleAt(1.0, 2);
+        sim35.scheduleAt(2.0, 3); // Same time as 1, scheduled later
+        auto handler35 = [&trace35](EventSimulation<int>& sim, int id) {
+            trace35.emplace_back(sim.now(), id);
+            if (id < 3) sim.schedule(1.5, id + 10);
+        };
+        assert(sim35.run(handler35, 2.0) == 3 && sim35.now() == 2.0 && sim35.pending() == 2 &&
+               "Test 35 Failed: run until");
+        assert((trace35 == vector<pair<double, int>>{{1.0, 2}, {2.0, 1}, {2.0, 3}}) &&
+               "Test 35 Failed: time order or FIFO ties");
+        assert(sim35.run(handler35, numeric_limits<double>::infinity(), 1) == 1 && trace35.back() == make_pair(2.5, 12) &&
+               "Test 35 Failed: maxEvents");
+        bool threw35 = false;
+        try {
+            sim35.scheduleAt(1.0, 0);
+        } catch (const invalid_argument&) {
+            threw35 = true;
+        }
+        assert(threw35 && "Test 35 Failed: event in the past");
+        assert(sim35.run(handler35) == 1 && sim35.pending() == 0 && sim35.now() == 3.5 && "Test 35 Failed: drain");
+
+        for (IncrementDistribution distribution :
+             {IncrementDistribution::Exponential, IncrementDistribution::Uniform, IncrementDistribution::Bimodal,
+              IncrementDistribution::Triangular}) {
+            HoldIncrement increment35(distribution, 35);
+            double sum = 0;
+            for (int i = 0; i < 200000; ++i) {
+                double value = increment35();
+                assert(value >= 0.0 && "Test 35 Failed: negative increment");
+                sum += value;
+            }
+            assert(abs(sum / 200000 - 1.0) < 0.05 && "Test 35 Failed: increment mean");
+        }
+    }
+    cout << "Test 35 Passed." << endl;
+
+    // Test 36: Branchless merge selected by comparator
+    {
+        LeftistTree<int, BranchlessLess<int>> branchless36;
+        LeftistTree<int> reference36;
+        mt19937 rng36(36);
+        for (int i = 0; i < 5000; ++i) {
+            int key = static_cast<int>(rng36() % 1000);
+            branchless36.insert(key);
+            reference36.insert(key);
+            if (i % 3 == 0) {
+                int a = branchless36.extractMin();
+                int b = reference36.extractMin();
+                assert(a == b && "Test 36 Failed: extractMin during churn");
+            }
+        }
+        LeftistTree<int, BranchlessLess<int>> other36;
+        for (int i = 0; i < 500; ++i) other36.insert(static_cast<int>(rng36() % 2000));
+        vector<int> expected36;
+        for (int i = 0; i < 500; ++i) expected36.push_back(other36.extractMin());
+        for (int key : expected36) other36.insert(key);
+        branchless36.mergeWith(other36);
+        for (int key : expected36) reference36.insert(key);
+        assert(branchless36.size() == reference36.size() && branchless36.rootNPL() >= 0 &&
+               "Test 36 Failed: mergeWith");
+        while (!reference36.isEmpty()) {
+            int a = branchless36.extractMin();
+            int b = reference36.extractMin();
+            assert(a == b && "Test 36 Failed: drain order");
+        }
+        assert(branchless36.isEmpty() && "Test 36 Failed: drained");
+        static_assert(BranchlessMerge<uint64_t, BranchlessLess<uint64_t>>::value &&
+                      !BranchlessMerge<int, less<int>>::value && !BranchlessMerge<string, BranchlessLess<string>>::value);
+    }
+    cout << "Test 36 Passed." << endl;
+
+
+    cout << "All LeftistTree tests passed!" << endl;
+}
+
+void runLeftistTreeSample() {
+    LeftistTree<int> lt;
+
+    cout << "Inserting elements: 10, 5, 20, 3, 15, 2" << endl;
+    lt.insert(10);
+    lt.insert(5);
+    lt.insert(20);
+    lt.insert(3);
+    lt.insert(15);
+    lt.insert(2);
+
+    cout << "\nTree structure after insertions:" << endl;
+    lt.printTree();
+
+    cout << "\nMin element: " << lt.getMin() << endl;
+
+    cout << "\nExtracting min elements:" << endl;
+    while (!lt.isEmpty()) {
+        cout << "Extracted: " << lt.extractMin() << endl;
+        if (!lt.isEmpty()) {
+             cout << "Current Tree Structure:" << endl;
+             lt.printTree();
+             cout << "Next Min: " << lt.getMin() << endl;
+        } else {
+            cout << "Tree is now empty." << endl;
+        }
+        cout << "----" << endl;
+    }
+
+    cout << "\nTesting merge operation:" << endl;
+    LeftistTree<int> lt1, lt2;
+    lt1.insert(10);
+    lt1.insert(20);
+    lt1.insert(5);
+    cout << "Tree 1:" << endl;
+    lt1.printTree();
+
+
+    lt2.insert(15);
+    lt2.insert(8);
+    lt2.insert(25);
+    cout << "\nTree 2:" << endl;
+    lt2.printTree();
+
+    lt1.mergeWith(lt2);
+    cout << "\nTree 1 after merging with Tree 2:" << endl;
+    lt1.printTree();
+
+    cout << "\nTree 2 after being merged (should be empty):" << endl;
+    lt2.printTree();
+
+    cout << "\nExtracting from merged tree:" << endl;
+     while (!lt1.isEmpty()) {
+        cout << "Extracted: " << lt1.extractMin() << endl;
+    }
+
+}
+
+// Runs fn once and returns the elapsed wall-clock time in milliseconds
+template <typename F>
+double measureMs(F&& fn) {
+    auto start = chrono::steady_clock::now();
+    fn();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+void benchmarkHeapify() {
+    cout << "Heapify vs repeated insert:" << endl;
+    mt19937 rng(2024);
+    for (size_t n : {size_t(1000), size_t(100000), size_t(10000000)}) {
+        vector<int> keys(n);
+        for (int& key : keys) key = static_cast<int>(rng());
+
+        int minByInsert = 0, minByHeapify = 0;
+        double insertMs = measureMs([&] {
+            LeftistTree<int> lt;
+            for (int key : keys) lt.insert(key);
+            minByInsert = lt.getMin();
+        });
+        double heapifyMs = measureMs([&] {
+            LeftistTree<int> lt(keys.begin(), keys.end());
+            minByHeapify = lt.getMin();
+        });
+        assert(minByInsert == minByHeapify);
+        cout << "  n=" << n << ": insert " << insertMs << " ms, heapify " << heapifyMs << " ms" << endl;
+    }
+}
+
+// Insert-heavy mix: every round inserts 16 keys into each of 64 heaps, melds
+// them pairwise into one and pops 16 elements from it
+template <typename Heap>
+double runMeldHeavyMix(size_t rounds) {
+    mt19937 rng(7);
+    long long checksum = 0;
+    Heap total;
+    double ms = measureMs([&] {
+        for (size_t round = 0; round < rounds; ++round) {
+            vector<Heap> heaps(64);
+            for (Heap& heap : heaps) {
+                for (int i = 0; i < 16; ++i) heap.insert(static_cast<int>(rng()));
+            }
+            for (Heap& heap : heaps) total.mergeWith(heap);
+            for (int i = 0; i < 16; ++i) checksum += total.extractMin();
+        }
+    });
+    assert(checksum != 0);
+    return ms;
+}
+
+// Insert-heavy mix on one heap: nine inserts for every extractMin
+template <typename Heap>
+double runInsertHeavyMix(size_t ops) {
+    mt19937 rng(8);
+    long long checksum = 0;
+    Heap heap;
+    double ms = measureMs([&] {
+        for (size_t i = 0; i < ops; ++i) {
+            if (i % 10 == 9) {
+                checksum += heap.extractMin();
+            } else {
+                heap.insert(static_cast<int>(rng()));
+            }
+        }
+    });
+    assert(checksum != 0);
+    return ms;
+}
+
+void benchmarkLazyMerge() {
+    cout << "Eager vs lazy merge, insert/meld-heavy mix:" << endl;
+    for (size_t rounds : {size_t(100), size_t(1000), size_t(5000)}) {
+        double eagerMs = runMeldHeavyMix<LeftistTree<int>>(rounds);
+        double lazyMs = runMeldHeavyMix<LazyLeftistTree<int>>(rounds);
+        cout << "  rounds=" << rounds << ": eager " << eagerMs << " ms, lazy " << lazyMs << " ms" << endl;
+    }
+    cout << "Eager vs lazy merge, 90% insert / 10% extractMin:" << endl;
+    for (size_t ops : {size_t(100000), size_t(1000000), size_t(10000000)}) {
+        double eagerMs = runInsertHeavyMix<LeftistTree<int>>(ops);
+        double lazyMs = runInsertHeavyMix<LazyLeftistTree<int>>(ops);
+        cout << "  ops=" << ops << ": eager " << eagerMs << " ms, lazy " << lazyMs << " ms" << endl;
+    }
+    // Bulk lazy insert only appends to the pending list, so 4x the keys should
+    // cost about 4x the time (Test 13 checks the allocation count)
+    auto bulkLazyInsertMs = [](size_t n) {
+        size_t kept = 0;
+        double ms = measureMs([n, &kept] {
+            LazyLeftistTree<int> heap;
+            for (size_t i = 0; i < n; ++i) heap.insert(static_cast<int>(n - i));
+            kept = heap.size();
+        });
+        assert(kept == n);
+        return ms;
+    };
+    double smallMs = bulkLazyInsertMs(100000);
+    double largeMs = bulkLazyInsertMs(400000);
+    cout << "Bulk lazy insert: 100k keys " << smallMs << " ms, 400k keys " << largeMs << " ms (x"
+         << largeMs / smallMs << ")" << endl;
+}
+
+// Builds 1024 heaps drawing from one shared node store, then melds them pairwise
+// into one and drains it
+template <typename Heap, typename Store>
+double runMeldThroughput(size_t n, const shared_ptr<Store>& store, long long& checksum) {
+    mt19937 rng(9);
+    vector<unique_ptr<Heap>> heaps;
+    for (int i = 0; i < 1024; ++i) heaps.push_back(make_unique<Heap>(store));
+    for (size_t i = 0; i < n; ++i) heaps[i % heaps.size()]->insert(static_cast<int>(rng()));
+    return measureMs([&] {
+        for (size_t width = 1; width < heaps.size(); width *= 2) {
+            for (size_t i = 0; i + width < heaps.size(); i += 2 * width) {
+                heaps[i]->mergeWith(*heaps[i + width]);
+            }
+        }
+        while (!heaps[0]->isEmpty()) checksum += heaps[0]->extractMin();
+    });
+}
+
+void benchmarkCompactLayout() {
+    cout << "Pointer vs compact layout (" << sizeof(Node<int>) << " vs "
+         << CompactArena<int>::bytesPerNode() << " bytes per int element):" << endl;
+    for (size_t n : {size_t(100000), size_t(1000000), size_t(10000000)}) {
+        long long pointerSum = 0, compactSum = 0;
+        double pointerMs = runMeldThroughput<LeftistTree<int>>(n, make_shared<LeftistTree<int>::Pool>(), pointerSum);
+        double compactMs = runMeldThroughput<CompactLeftistTree<int>>(n, make_shared<CompactArena<int>>(), compactSum);
+        assert(pointerSum == compactSum);
+        cout << "  n=" << n << ": meld + drain pointer " << pointerMs << " ms, compact " << compactMs << " ms" << endl;
+    }
+}
+
+// Producers push opsPerThread keys each, consumers pop until everything is gone.
+// batch == 0 models the global-mutex baseline: one locked insert per key
+double runConcurrentThroughput(int threads, size_t opsPerThread, size_t batch) {
+    ConcurrentLeftistTree<int> shared;
+    mutex baselineLock;
+    LeftistTree<int> baseline;
+    atomic<int> producersDone(0);
+    atomic<long long> consumed(0);
+    int producers = max(1, threads / 2), consumers = max(1, threads - producers);
+    long long total = static_cast<long long>(producers) * static_cast<long long>(opsPerThread);
+    return measureMs([&] {
+        vector<thread> workers;
+        for (int p = 0; p < producers; ++p) {
+            workers.emplace_back([&, p] {
+                mt19937 rng(p);
+                LeftistTree<int> local;
+                for (size_t i = 0; i < opsPerThread; ++i) {
+                    if (batch == 0) {
+                        lock_guard<mutex> guard(baselineLock);
+                        baseline.insert(static_cast<int>(rng()));
+                        continue;
+                    }
+                    local.insert(static_cast<int>(rng()));
+                    if (i % batch == batch - 1) shared.publish(local);
+                }
+                shared.publish(local);
+                producersDone.fetch_add(1);
+            });
+        }
+        for (int c = 0; c < consumers; ++c) {
+            workers.emplace_back([&] {
+                int buffer[64];
+                while (consumed.load() < total) {
+                    size_t popped = 0;
+                    if (batch == 0) {
+                        lock_guard<mutex> guard(baselineLock);
+                        popped = baseline.extractMinBatch(1, buffer);
+                    } else {
+                        popped = shared.tryExtractMinBatch(64, buffer);
+                    }
+                    consumed.fetch_add(static_cast<long long>(popped));
+                    if (popped == 0) this_thread::yield();
+                }
+            });
+        }
+        for (thread& worker : workers) worker.join();
+    });
+}
+
+void benchmarkConcurrent() {
+    const size_t opsPerThread = 200000;
+    cout << "Concurrent heap throughput (Mops/s, " << thread::hardware_concurrency() << " hardware threads):" << endl;
+    for (int threads : {2, 4, 8, 16, 32}) {
+        double ops = static_cast<double>(max(1, threads / 2)) * static_cast<double>(opsPerThread) * 2;
+        double baselineMs = runConcurrentThroughput(threads, opsPerThread, 0);
+        double publishMs = runConcurrentThroughput(threads, opsPerThread, 256);
+        cout << "  threads=" << threads << ": global mutex " << ops / baselineMs / 1000
+             << ", publish batches of 256 " << ops / publishMs / 1000 << endl;
+    }
+}
+
+// Each thread runs opsPerThread rounds of insert + extractMin on a pre-filled heap
+template <typename Heap>
+double runHoldThroughput(Heap& heap, int threads, size_t opsPerThread) {
+    for (int i = 0; i < 100000; ++i) heap.insert(i * 7919 % 1000003);
+    return measureMs([&] {
+        vector<thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                mt19937 rng(t);
+                int key = 0;
+                for (size_t i = 0; i < opsPerThread; ++i) {
+                    heap.insert(static_cast<int>(rng() % 1000003));
+                    heap.tryExtractMin(key);
+                }
+            });
+        }
+        for (thread& worker : workers) worker.join();
+    });
+}
+
+void benchmarkSharded() {
+    const size_t opsPerThread = 100000;
+    cout << "Sharded vs single-lock heap, insert+extractMin pairs (Mops/s):" << endl;
+    for (int threads : {1, 2, 4, 8, 16, 32}) {
+        ConcurrentLeftistTree<int> single;
+        ShardedLeftistHeap<int> sharded(2 * static_cast<size_t>(threads));
+        double ops = 2.0 * threads * static_cast<double>(opsPerThread);
+        double singleMs = runHoldThroughput(single, threads, opsPerThread);
+        double shardedMs = runHoldThroughput(sharded, threads, opsPerThread);
+        cout << "  threads=" << threads << ": single lock " << ops / singleMs / 1000
+             << ", " << sharded.shardCount() << " shards " << ops / shardedMs / 1000 << endl;
+    }
+    cout << "Sharded heap rank error (sequential replay of 1e6 keys):" << endl;
+    for (size_t shardCount : {size_t(2), size_t(8), size_t(64)}) {
+        ShardedLeftistHeap<int> sharded(shardCount);
+        RankErrorMeter meter(1 << 20);
+        mt19937 rng(10);
+        for (int i = 0; i < 1000000; ++i) {
+            int key = static_cast<int>(rng() % (1 << 20));
+            sharded.insert(key);
+            meter.pushed(key);
+        }
+        int key = 0;
+        while (sharded.tryExtractMin(key)) meter.popped(key);
+        cout << "  shards=" << shardCount << ": mean " << meter.meanRankError() << ", max " << meter.maxRankError() << endl;
+    }
+}
+
+void benchmarkMeldAll() {
+    cout << "Serial mergeWith vs meldAll of 512 heaps x 2048 keys:" << endl;
+    for (unsigned threads : {1u, 2u, 4u, 8u}) {
+        auto build = [](vector<unique_ptr<LeftistTree<int>>>& heaps) {
+            mt19937 rng(11);
+            for (int h = 0; h < 512; ++h) {
+                vector<int> keys(2048);
+                for (int& key : keys) key = static_cast<int>(rng());
+                heaps.push_back(make_unique<LeftistTree<int>>(keys.begin(), keys.end()));
+            }
+        };
+        vector<unique_ptr<LeftistTree<int>>> serial, parallel;
+        build(serial);
+        build(parallel);
+        double serialMs = measureMs([&] {
+            for (size_t h = 1; h < serial.size(); ++h) serial[0]->mergeWith(*serial[h]);
+        });
+        vector<LeftistTree<int>*> targets;
+        for (auto& heap : parallel) targets.push_back(heap.get());
+        double parallelMs = measureMs([&] { LeftistTree<int>::meldAll(targets, threads); });
+        assert(serial[0]->getMin() == parallel[0]->getMin());
+        cout << "  threads=" << threads << ": serial " << serialMs << " ms, meldAll " << parallelMs << " ms" << endl;
+    }
+}
 
-    // Helper function to get NPL of a node (handles null)
-    int getNPL(Node* node) {
-        if (node == nullptr) {
-            return -1;
+void benchmarkRestart() {
+    cout << "Restart by re-inserting vs mapping a saved image:" << endl;
+    string path = (filesystem::temp_directory_path() / ("leftist_tree_restart_" + to_string(getpid()) + ".img")).string();
+    for (int n : {100000, 1000000, 4000000}) {
+        mt19937 rng(15);
+        vector<int> log(n);
+        for (int& key : log) key = static_cast<int>(rng());
+        {
+            LeftistTree<int> heap(log.begin(), log.end());
+            heap.saveImage(path);
         }
-        return node->npl;
+        int replayMin = 0, mappedMin = 0;
+        double replayMs = measureMs([&] {
+            LeftistTree<int> heap;
+            for (int key : log) heap.insert(key);
+            replayMin = heap.getMin();
+        });
+        double mapMs = measureMs([&] {
+            auto heap = CompactLeftistTree<int>::mapImage(path);
+            mappedMin = heap->getMin();
+        });
+        assert(replayMin == mappedMin);
+        (void)replayMin;
+        (void)mappedMin;
+        cout << "  N=" << n << ": replay " << replayMs << " ms, mapImage " << mapMs << " ms" << endl;
     }
+    filesystem::remove(path);
+}
 
-    // Helper function to swap children of a node
-    void swapChildren(Node* node) {
-        if (node) {
-            swap(node->left, node->right);
-        }
+void benchmarkSortedDrain() {
+    cout << "Draining a cold heap, extractMin loop vs drained() with prefetch:" << endl;
+    for (int n : {100000, 1000000, 4000000}) {
+        mt19937 rng(16);
+        vector<int> keys(n);
+        for (int& key : keys) key = static_cast<int>(rng());
+        long long loopSum = 0, rangeSum = 0;
+        LeftistTree<int> loopHeap, rangeHeap;
+        for (int key : keys) loopHeap.insert(key);
+        for (int key : keys) rangeHeap.insert(key);
+        double loopMs = measureMs([&] {
+            while (!loopHeap.isEmpty()) loopSum += loopHeap.extractMin();
+        });
+        double rangeMs = measureMs([&] {
+            for (int key : rangeHeap.drained()) rangeSum += key;
+        });
+        assert(loopSum == rangeSum);
+        cout << "  N=" << n << ": extractMin " << loopMs << " ms, drained " << rangeMs << " ms"
+             << (loopSum == rangeSum ? "" : " (mismatch)") << endl;
     }
+}
 
-    // Merges two leftist heaps h1 and h2, returns the root of the merged heap
-    // Time Complexity: O(log N), where N is the total number of nodes in both heaps.
-    // This is because the path we traverse during merging is always the right path,
-    // which has a maximum length proportional to the logarithm of the number of nodes.
-    // Space complexity for storing the tree itself: O(N)
-    Node* merge(Node* h1, Node* h2) {
-        if (h1 == nullptr) return h2;
-        if (h2 == nullptr) return h1;
+void benchmarkKWayMerge() {
+    cout << "Merging 1000 sorted runs x 4000 keys, KWayMerger vs extractMin+insert vs std::priority_queue:" << endl;
+    mt19937 rng(17);
+    vector<vector<int>> runs(1000, vector<int>(4000));
+    for (vector<int>& run : runs) {
+        for (int& key : run) key = static_cast<int>(rng());
+        sort(run.begin(), run.end());
+    }
+    vector<int> out(runs.size() * runs[0].size());
 
-        if (h1->key > h2->key) {
-            swap(h1, h2);
+    double mergerMs = measureMs([&] {
+        KWayMerger<int> merger;
+        for (vector<int>& run : runs) {
+            merger.addRun([&run, position = size_t(0)](int* buffer, size_t capacity) mutable {
+                size_t n = min(capacity, run.size() - position);
+                copy_n(run.begin() + position, n, buffer);
+                position += n;
+                return n;
+            });
         }
+        size_t written = 0;
+        while (size_t n = merger.read(out.data() + written, 4096)) written += n;
+    });
+    long long mergerSum = out[out.size() / 2];
 
-        h1->right = merge(h1->right, h2);
+    using HeadItem = pair<int, uint32_t>;
+    double popPushMs = measureMs([&] {
+        LeftistTree<HeadItem> heads;
+        vector<size_t> next(runs.size(), 1);
+        for (uint32_t r = 0; r < runs.size(); ++r) heads.insert(HeadItem(runs[r][0], r));
+        size_t written = 0;
+        while (!heads.isEmpty()) {
+            HeadItem top = heads.extractMin();
+            out[written++] = top.first;
+            if (next[top.second] < runs[top.second].size()) {
+                heads.insert(HeadItem(runs[top.second][next[top.second]++], top.second));
+            }
+        }
+    });
 
-        if (getNPL(h1->left) < getNPL(h1->right)) {
-            swapChildren(h1);
+    double stdMs = measureMs([&] {
+        priority_queue<HeadItem, vector<HeadItem>, greater<HeadItem>> heads;
+        vector<size_t> next(runs.size(), 1);
+        for (uint32_t r = 0; r < runs.size(); ++r) heads.emplace(runs[r][0], r);
+        size_t written = 0;
+        while (!heads.empty()) {
+            HeadItem top = heads.top();
+            heads.pop();
+            out[written++] = top.first;
+            if (next[top.second] < runs[top.second].size()) {
+                heads.emplace(runs[top.second][next[top.second]++], top.second);
+            }
         }
+    });
+    assert(out[out.size() / 2] == mergerSum);
+    (void)mergerSum;
+    cout << "  KWayMerger " << mergerMs << " ms, extractMin+insert " << popPushMs << " ms, std::priority_queue "
+         << stdMs << " ms" << endl;
+}
 
-        h1->npl = getNPL(h1->right) + 1;
+template <typename Heap>
+void reportBalancePolicy(const char* name) {
+    long long checksum = 0;
+    double meldMs = runMeldHeavyMix<Heap>(5000);
+    double insertMs = runInsertHeavyMix<Heap>(1000000);
+    double throughputMs = runMeldThroughput<Heap>(1 << 20, make_shared<typename Heap::Pool>(), checksum);
+    cout << "  " << name << ": meld-heavy " << meldMs << " ms, insert-heavy " << insertMs << " ms, 1024-way meld + drain "
+         << throughputMs << " ms" << endl;
+}
 
-        return h1;
-    }
+void benchmarkBalancePolicies() {
+    cout << "Balance policies (height-biased, weight-biased, skew):" << endl;
+    reportBalancePolicy<LeftistTree<int>>("height-biased");
+    reportBalancePolicy<WeightBiasedLeftistTree<int>>("weight-biased");
+    reportBalancePolicy<SkewHeap<int>>("skew");
+    cout << "  node bytes (int / long long keys): height-biased " << sizeof(Node<int, false, HeightBiased>) << " / "
+         << sizeof(Node<long long, false, HeightBiased>) << ", weight-biased " << sizeof(Node<int, false, WeightBiased>)
+         << " / " << sizeof(Node<long long, false, WeightBiased>) << ", skew " << sizeof(Node<int, false, Skew>)
+         << " / " << sizeof(Node<long long, false, Skew>) << endl;
+}
 
-    // Helper for destructor: recursively delete nodes
-    void destroyRecursive(Node* node) {
-        if (node) {
-            destroyRecursive(node->left);
-            destroyRecursive(node->right);
-            delete node;
-        }
+void benchmarkPersistent() {
+    cout << "Forking a 1M-key heap and running 1000 inserts + 1000 extractMins on the fork:" << endl;
+    mt19937 rng(21);
+    vector<int> keys(1000000);
+    for (int& key : keys) key = static_cast<int>(rng());
+    PersistentLeftistHeap<int> base;
+    for (int key : keys) base.insert(key);
+    long long persistentSum = 0, copySum = 0;
+    double persistentMs = measureMs([&] {
+        PersistentLeftistHeap<int> fork = base;
+        for (int i = 0; i < 1000; ++i) fork.insert(static_cast<int>(rng()));
+        for (int i = 0; i < 1000; ++i) persistentSum += fork.extractMin();
+    });
+    double copyMs = measureMs([&] {
+        LeftistTree<int> copy(keys.begin(), keys.end()); // What a branch costs without sharing
+        for (int i = 0; i < 1000; ++i) copy.insert(static_cast<int>(rng()));
+        for (int i = 0; i < 1000; ++i) copySum += copy.extractMin();
+    });
+    assert(persistentSum != 0 && copySum != 0);
+    cout << "  persistent fork " << persistentMs << " ms, rebuilt copy " << copyMs << " ms" << endl;
+}
+
+void benchmarkInsertBatch() {
+    cout << "Inserting 4M keys in batches of 4096, insert loop vs insertBatch:" << endl;
+    mt19937 rng(23);
+    vector<int> ascending(1 << 22), nearlySorted, random(1 << 22);
+    iota(ascending.begin(), ascending.end(), 0);
+    nearlySorted = ascending;
+    for (size_t i = 0; i + 8 < nearlySorted.size(); i += 64) swap(nearlySorted[i], nearlySorted[i + rng() % 8]);
+    for (int& key : random) key = static_cast<int>(rng());
+    for (auto [name, keys] : {pair<const char*, vector<int>*>("ascending", &ascending),
+                              pair<const char*, vector<int>*>("nearly sorted", &nearlySorted),
+                              pair<const char*, vector<int>*>("random", &random)}) {
+        LeftistTree<int> looped, batched;
+        double loopMs = measureMs([&] {
+            for (int key : *keys) looped.insert(key);
+        });
+        double batchMs = measureMs([&] {
+            for (size_t i = 0; i < keys->size(); i += 4096) {
+                batched.insertBatch(span<const int>(keys->data() + i, min<size_t>(4096, keys->size() - i)));
+            }
+        });
+        assert(looped.getMin() == batched.getMin());
+        cout << "  " << name << ": insert " << loopMs << " ms, insertBatch " << batchMs << " ms" << endl;
     }
+}
 
-    // Helper for pretty printing the tree structure
-    void printTreeRecursive(Node* node, const string& prefix, bool isLeft) const {
-        if (node == nullptr) {
-            return;
+void benchmarkCompact() {
+    cout << "Hold model on a 1M-key heap after 20M churn operations, before and after compact():" << endl;
+    mt19937 rng(24);
+    LeftistTree<int> heap;
+    for (int i = 0; i < 1000000; ++i) heap.insert(static_cast<int>(rng() % 1000000));
+    auto hold = [&](size_t ops) {
+        for (size_t i = 0; i < ops; ++i) heap.insert(heap.extractMin() + static_cast<int>(rng() % 1000000));
+    };
+    hold(20000000);
+    const size_t ops = 200000;
+    double beforeMs = measureMs([&] { hold(ops); });
+    double compactMs = measureMs([&] { heap.compact(); });
+    double afterMs = measureMs([&] { hold(ops); });
+    double laterMs = measureMs([&] { hold(ops); });
+    cout << "  before " << beforeMs * 1e6 / ops << " ns/op, compact() " << compactMs << " ms, next " << ops
+         << " ops " << afterMs * 1e6 / ops << " ns/op, the " << ops << " after those " << laterMs * 1e6 / ops
+         << " ns/op" << endl;
+}
+
+void benchmarkTopK() {
+    cout << "Smallest 1000 of a 20M-key stream:" << endl;
+    mt19937 rng(26);
+    vector<int> stream(20000000);
+    for (int& key : stream) key = static_cast<int>(rng());
+    vector<int> bounded, unbounded, binary;
+    double boundedMs = measureMs([&] {
+        BoundedTopK<int> top(1000);
+        for (int key : stream) top.offer(key);
+        top.drainSorted(back_inserter(bounded));
+    });
+    double unboundedMs = measureMs([&] {
+        LeftistTree<int> heap;
+        for (int key : stream) heap.insert(key);
+        heap.extractMinBatch(1000, back_inserter(unbounded));
+    });
+    double binaryMs = measureMs([&] {
+        priority_queue<int> top; // Max-heap of the kept keys
+        for (int key : stream) {
+            if (top.size() < 1000) {
+                top.push(key);
+            } else if (key < top.top()) {
+                top.pop();
+                top.push(key);
+            }
+        }
+        while (!top.empty()) {
+            binary.push_back(top.top());
+            top.pop();
         }
+        reverse(binary.begin(), binary.end());
+    });
+    assert(bounded == unbounded && bounded == binary);
+    cout << "  BoundedTopK " << boundedMs << " ms, unbounded LeftistTree " << unboundedMs
+         << " ms, bounded std::priority_queue " << binaryMs << " ms" << endl;
+}
 
-        cout << prefix;
-        cout << (isLeft ? "├──L:" : "└──R:");
-        cout << node->key << " (npl:" << node->npl << ")" << endl;
+// Two-pass pairing heap, used only as a reference point by the benchmark suite
+template <typename T, typename Compare = less<T>>
+class PairingHeap {
+private:
+    struct PairingNode {
+        T key;
+        PairingNode *child;   // First child
+        PairingNode *sibling; // Next sibling, or next free node in the free list
+    };
 
-        printTreeRecursive(node->left, prefix + (isLeft ? "│   " : "    "), true);
-        printTreeRecursive(node->right, prefix + (isLeft ? "│   " : "    "), false);
+    PairingNode *root;
+    vector<unique_ptr<PairingNode[]>> blocks;
+    PairingNode *freeList;
+    PairingNode *freeTail; // Last node of freeList, so melds splice it in O(1)
+    size_t blockUsed;
+    Compare comp;
+    vector<PairingNode*> pairs; // Scratch space of extractMin, kept to avoid an allocation per pop
+
+    static constexpr size_t kBlockNodes = 1024;
+
+    PairingNode* allocate(const T& key) {
+        PairingNode* node;
+        if (freeList) {
+            node = freeList;
+            freeList = node->sibling;
+            if (freeList == nullptr) freeTail = nullptr;
+        } else {
+            if (blocks.empty() || blockUsed == kBlockNodes) {
+                blocks.push_back(make_unique<PairingNode[]>(kBlockNodes));
+                blockUsed = 0;
+            }
+            node = &blocks.back()[blockUsed++];
+        }
+        *node = PairingNode{key, nullptr, nullptr};
+        return node;
     }
 
+    PairingNode* link(PairingNode* a, PairingNode* b) {
+        if (a == nullptr) return b;
+        if (b == nullptr) return a;
+        if (comp(b->key, a->key)) swap(a, b);
+        b->sibling = a->child;
+        a->child = b;
+        return a;
+    }
 
 public:
-    LeftistTree() : root(nullptr) {}
+    PairingHeap() : root(nullptr), freeList(nullptr), freeTail(nullptr), blockUsed(0) {}
 
-    ~LeftistTree() {
-        destroyRecursive(root);
+    template <typename InputIt>
+    PairingHeap(InputIt first, InputIt last) : PairingHeap() {
+        for (; first != last; ++first) insert(*first);
     }
 
     bool isEmpty() const {
         return root == nullptr;
     }
 
-    // Insert a new key into the tree
-    void insert(int key) {
-        Node* newNode = new Node(key);
-        root = merge(root, newNode);
+    void insert(const T& key) {
+        root = link(root, allocate(key));
     }
 
-    // Get the minimum key (root key) without removing it
-    int getMin() const {
-        if (isEmpty()) {
-            throw runtime_error("Heap is empty!");
-        }
+    const T& getMin() const {
         return root->key;
     }
 
-    // Remove and return the minimum key
-    int extractMin() {
-        if (isEmpty()) {
-            throw runtime_error("Heap is empty! Cannot extract min.");
+    T extractMin() {
+        T minKey = root->key;
+        pairs.clear();
+        for (PairingNode* child = root->child; child != nullptr;) {
+            PairingNode* first = child;
+            PairingNode* second = child->sibling;
+            child = second ? second->sibling : nullptr;
+            first->sibling = nullptr;
+            if (second) second->sibling = nullptr;
+            pairs.push_back(link(first, second));
         }
-
-        int minKey = root->key;
-        Node* oldRoot = root;
-        root = merge(root->left, root->right);
-        delete oldRoot;
+        PairingNode* merged = nullptr;
+        for (size_t i = pairs.size(); i > 0; --i) {
+            merged = link(pairs[i - 1], merged);
+        }
+        root->sibling = freeList;
+        if (freeList == nullptr) freeTail = root;
+        freeList = root;
+        root = merged;
         return minKey;
     }
 
-    // Public interface to merge another LeftistTree into this one
-    void mergeWith(LeftistTree& otherTree) {
-        if (this == &otherTree) {
+    // Takes over other's node blocks along with its nodes, and splices its free
+    // list in front of ours
+    void mergeWith(PairingHeap& other) {
+        if (this == &other) {
             return;
         }
-        root = merge(this->root, otherTree.root);
-        otherTree.root = nullptr;
+        root = link(root, other.root);
+        other.root = nullptr;
+        if (other.freeList) {
+            other.freeTail->sibling = freeList;
+            if (freeList == nullptr) freeTail = other.freeTail;
+            freeList = other.freeList;
+        }
+        // The last block is the one allocate() bumps through. If we have none,
+        // other's last block becomes ours, so take over its fill level too;
+        // otherwise other's blocks go in front and ours stays last.
+        if (blocks.empty()) {
+            blockUsed = other.blockUsed;
+        }
+        blocks.insert(blocks.begin(), make_move_iterator(other.blocks.begin()), make_move_iterator(other.blocks.end()));
+        other.blocks.clear();
+        other.freeList = nullptr;
+        other.freeTail = nullptr;
+        other.blockUsed = 0;
     }
+};
 
-    void printTree() const {
-        if (isEmpty()) {
-            cout << "Tree is empty." << endl;
-            return;
+// std::priority_queue behind the interface the benchmark suite expects
+template <typename T, typename Compare = less<T>, typename Allocator = allocator<T>>
+class StdPriorityQueueHeap {
+private:
+    struct Reversed {
+        Compare comp;
+        bool operator()(const T& a, const T& b) const {
+            return comp(b, a);
         }
-        printTreeRecursive(root, "", false);
+    };
+
+    priority_queue<T, vector<T, Allocator>, Reversed> queue;
+
+public:
+    StdPriorityQueueHeap() {}
+
+    template <typename InputIt>
+    StdPriorityQueueHeap(InputIt first, InputIt last) : queue(first, last) {}
+
+    bool isEmpty() const {
+        return queue.empty();
     }
-};
 
-void testLeftistTree() {
-    cout << "Starting LeftistTree tests..." << endl;
+    void insert(const T& key) {
+        queue.push(key);
+    }
 
-    // Test 1: Basic insert and getMin
-    LeftistTree lt1;
-    lt1.insert(10);
-    lt1.insert(5);
-    lt1.insert(20);
-    assert(lt1.getMin() == 5 && "Test 1 Failed: Basic insert and getMin");
-    cout << "Test 1 Passed." << endl;
+    const T& getMin() const {
+        return queue.top();
+    }
 
-    // Test 2: ExtractMin
-    assert(lt1.extractMin() == 5 && "Test 2 Failed: First extractMin");
-    assert(lt1.getMin() == 10 && "Test 2 Failed: getMin after first extract");
-    assert(lt1.extractMin() == 10 && "Test 2 Failed: Second extractMin");
-    assert(lt1.getMin() == 20 && "Test 2 Failed: getMin after second extract");
-    assert(lt1.extractMin() == 20 && "Test 2 Failed: Third extractMin");
-    assert(lt1.isEmpty() && "Test 2 Failed: isEmpty after all extracts");
-    cout << "Test 2 Passed." << endl;
+    T extractMin() {
+        T minKey = queue.top();
+        queue.pop();
+        return minKey;
+    }
 
-    // Test 3: Insert multiple elements and extract all
-    LeftistTree lt2;
-    lt2.insert(15);
-    lt2.insert(3);
-    lt2.insert(8);
-    lt2.insert(1);
-    lt2.insert(12);
-    assert(lt2.getMin() == 1 && "Test 3 Failed: getMin with multiple inserts");
-    assert(lt2.extractMin() == 1 && "Test 3 Failed: extractMin 1");
-    assert(lt2.extractMin() == 3 && "Test 3 Failed: extractMin 3");
-    assert(lt2.extractMin() == 8 && "Test 3 Failed: extractMin 8");
-    assert(lt2.extractMin() == 12 && "Test 3 Failed: extractMin 12");
-    assert(lt2.extractMin() == 15 && "Test 3 Failed: extractMin 15");
-    assert(lt2.isEmpty() && "Test 3 Failed: isEmpty after all extracts");
-    cout << "Test 3 Passed." << endl;
+    // No meld in a binary heap: every element of other is pushed, O(M log N)
+    void mergeWith(StdPriorityQueueHeap& other) {
+        while (!other.queue.empty()) {
+            queue.push(other.queue.top());
+            other.queue.pop();
+        }
+    }
+};
 
-    // Test 4: Merging trees
-    LeftistTree lt3a, lt3b;
-    lt3a.insert(10); lt3a.insert(20); lt3a.insert(5);
-    lt3b.insert(15); lt3b.insert(8); lt3b.insert(25);
-    lt3a.mergeWith(lt3b);
-    assert(lt3b.isEmpty() && "Test 4 Failed: Merged tree B is not empty");
-    assert(!lt3a.isEmpty() && "Test 4 Failed: Merged tree A is empty");
+// The baseline heaps the benchmarks compare against are defined after
+// testLeftistTree, so they are checked here
+void testBaselineHeaps() {
+    // Test 37: Pairing heap melds, including into a heap that never allocated
+    {
+        PairingHeap<int> empty37, filled37;
+        for (int i = 0; i < 10; ++i) filled37.insert(9 - i);
+        empty37.mergeWith(filled37);
+        empty37.insert(5); // Must not reuse a slot of the adopted, partly used block
+        vector<int> drained37;
+        while (!empty37.isEmpty() && drained37.size() <= 11) drained37.push_back(empty37.extractMin());
+        assert((drained37 == vector<int>{0, 1, 2, 3, 4, 5, 5, 6, 7, 8, 9}) && "Test 37 Failed: merge into empty");
 
-    vector<int> extracted_merged;
-    while(!lt3a.isEmpty()) {
-        extracted_merged.push_back(lt3a.extractMin());
+        mt19937 rng37(37);
+        multiset<int> model37;
+        PairingHeap<int> target37;
+        for (int round = 0; round < 50; ++round) {
+            PairingHeap<int> source37;
+            for (int i = 0; i < 1500; ++i) { // Spans blocks, partly used last one
+                int key = static_cast<int>(rng37() % 10000);
+                source37.insert(key);
+                model37.insert(key);
+            }
+            for (int i = 0; i < 200; ++i) model37.erase(model37.find(source37.extractMin()));
+            target37.mergeWith(source37);
+            assert(source37.isEmpty() && "Test 37 Failed: source not emptied");
+            PairingHeap<int> none37;
+            target37.mergeWith(none37);
+            for (int i = 0; i < 300; ++i) {
+                int key = target37.extractMin();
+                assert(key == *model37.begin() && "Test 37 Failed: extractMin after meld");
+                model37.erase(model37.begin());
+            }
+            for (int i = 0; i < 400; ++i) { // Reuses free and adopted nodes
+                int key = static_cast<int>(rng37() % 10000);
+                target37.insert(key);
+                model37.insert(key);
+            }
+        }
+        while (!target37.isEmpty()) {
+            int key = target37.extractMin();
+            assert(key == *model37.begin() && "Test 37 Failed: drain");
+            model37.erase(model37.begin());
+        }
+        assert(model37.empty() && "Test 37 Failed: keys lost");
     }
-    vector<int> expected_merged = {5, 8, 10, 15, 20, 25};
-    assert(extracted_merged == expected_merged && "Test 4 Failed: Merged tree elements incorrect");
-    cout << "Test 4 Passed." << endl;
+    cout << "Test 37 Passed." << endl;
 
-    // Test 5: Merging an empty tree
-    LeftistTree lt4a, lt4b;
-    lt4a.insert(100);
-    lt4a.mergeWith(lt4b);
-    assert(lt4a.getMin() == 100 && "Test 5 Failed: Merging with empty tree");
-    assert(lt4b.isEmpty() && "Test 5 Failed: Empty tree changed after merge");
-    assert(lt4a.extractMin() == 100 && "Test 5 Failed: Extract after merge with empty");
-    assert(lt4a.isEmpty() && "Test 5 Failed: Not empty after extract");
+    // Test 38: std::priority_queue wrapper
+    {
+        StdPriorityQueueHeap<int> a38, b38;
+        for (int key : {4, 1, 3}) a38.insert(key);
+        for (int key : {2, 0}) b38.insert(key);
+        a38.mergeWith(b38);
+        vector<int> drained38;
+        while (!a38.isEmpty()) drained38.push_back(a38.extractMin());
+        assert(b38.isEmpty() && (drained38 == vector<int>{0, 1, 2, 3, 4}) && "Test 38 Failed: order after meld");
+    }
+    cout << "Test 38 Passed." << endl;
+}
 
-    lt4b.insert(200);
-    lt4b.mergeWith(lt4a);
-    assert(lt4b.getMin() == 200 && "Test 5 Failed: Merging empty into non-empty");
-    assert(lt4a.isEmpty() && "Test 5 Failed: Empty tree changed after merge");
-    assert(lt4b.extractMin() == 200 && "Test 5 Failed: Extract after merge empty into non-empty");
-    assert(lt4b.isEmpty() && "Test 5 Failed: Not empty after extract");
-    cout << "Test 5 Passed." << endl;
+// Keeps results observable so the optimizer cannot drop benchmarked work
+volatile long long benchmarkSink = 0;
 
+// Timeout workload of a server holding 1M connections. Every tick some
+// connections see traffic and re-arm to now + timeout (one in eight with a
+// shorter, out-of-order timeout), then expired timers are polled. Keys pack
+// (deadline << 32 | timer id) with ids handed out in arming order, so equal
+// deadlines keep arming order. Re-arming leaves the old timer behind; a polled
+// timer only fires if it is still its connection's current one.
+template <typename Heap, typename Poll>
+double runTimerWorkload(Poll poll, size_t& fired) {
+    constexpr uint32_t connections = 1000000, timeout = 1000, ticks = 4000, perTick = 2000;
+    mt19937 rng(28);
+    vector<uint32_t> initial(connections);
+    for (uint32_t& deadline : initial) deadline = rng() % timeout;
+    vector<pair<uint32_t, uint32_t>> events(static_cast<size_t>(ticks) * perTick); // (connection, timeout)
+    for (auto& [conn, after] : events) {
+        conn = rng() % connections;
+        after = rng() % 8 == 0 ? 1 + rng() % (timeout / 4) : timeout;
+    }
+    vector<uint32_t> connOf;  // timer id -> connection
+    vector<uint32_t> timerOf; // connection -> current timer id
+    connOf.reserve(connections + events.size());
+    timerOf.resize(connections);
+    vector<uint64_t> expired;
+    Heap heap;
+    fired = 0;
+    auto arm = [&](uint32_t conn, uint32_t deadline) {
+        uint32_t id = static_cast<uint32_t>(connOf.size());
+        connOf.push_back(conn);
+        timerOf[conn] = id;
+        heap.insert(static_cast<uint64_t>(deadline) << 32 | id);
+    };
+    return measureMs([&] {
+        for (uint32_t conn = 0; conn < connections; ++conn) {
+            arm(conn, initial[conn]);
+        }
+        const pair<uint32_t, uint32_t>* event = events.data();
+        for (uint32_t now = 0; now < ticks; ++now) {
+            for (uint32_t i = 0; i < perTick; ++i, ++event) {
+                arm(event->first, now + event->second);
+            }
+            expired.clear();
+            poll(heap, static_cast<uint64_t>(now) << 32 | numeric_limits<uint32_t>::max(), expired);
+            for (uint64_t key : expired) {
+                uint32_t id = static_cast<uint32_t>(key);
+                fired += timerOf[connOf[id]] == id;
+            }
+        }
+    });
+}
 
-    // Test 6: Operations on empty tree (should throw exceptions)
-    LeftistTree emptyLt;
-    assert(emptyLt.isEmpty() && "Test 6 Failed: Newly created tree is not empty");
-    try {
-        emptyLt.getMin();
-        assert(false && "Test 6 Failed: getMin on empty tree did not throw");
-    } catch (const runtime_error& e) {
-        assert(string(e.what()) == "Heap is empty!" && "Test 6 Failed: getMin exception message incorrect");
+void benchmarkTimerQueue() {
+    cout << "Timer queue, 1M connections, 4000 ticks x 2000 re-arms:" << endl;
+    size_t timerFired, treeFired, binaryFired;
+    double timerMs = runTimerWorkload<TimerLeftistHeap<uint64_t>>(
+        [](TimerLeftistHeap<uint64_t>& heap, uint64_t now, vector<uint64_t>& out) {
+            heap.pollExpired(now, back_inserter(out));
+        },
+        timerFired);
+    double treeMs = runTimerWorkload<LeftistTree<uint64_t>>(
+        [](LeftistTree<uint64_t>& heap, uint64_t now, vector<uint64_t>& out) {
+            while (!heap.isEmpty() && heap.getMin() <= now) out.push_back(heap.extractMin());
+        },
+        treeFired);
+    double binaryMs = runTimerWorkload<StdPriorityQueueHeap<uint64_t>>(
+        [](StdPriorityQueueHeap<uint64_t>& heap, uint64_t now, vector<uint64_t>& out) {
+            while (!heap.isEmpty() && heap.getMin() <= now) out.push_back(heap.extractMin());
+        },
+        binaryFired);
+    assert(timerFired == treeFired && timerFired == binaryFired);
+    cout << "  TimerLeftistHeap " << timerMs << " ms, LeftistTree " << treeMs << " ms, std::priority_queue "
+         << binaryMs << " ms (" << timerFired << " fired)" << endl;
+}
+
+// One hardware counter of the calling thread, user space only, via
+// perf_event_open. isAvailable() is false off Linux or when the kernel refuses
+// (perf_event_paranoid, containers, no PMU), and stop() then returns nullopt.
+class PerfCounter {
+public:
+    enum Event { CacheMisses, BranchMisses, Instructions };
+
+private:
+    int fd;
+
+public:
+    explicit PerfCounter(Event event) : fd(-1) {
+#if LEFTIST_TREE_HAS_PERF_EVENTS
+        static const uint64_t configs[] = {PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+                                           PERF_COUNT_HW_INSTRUCTIONS};
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = configs[event];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+        (void)event;
+#endif
     }
-    try {
-        emptyLt.extractMin();
-        assert(false && "Test 6 Failed: extractMin on empty tree did not throw");
-    } catch (const runtime_error& e) {
-        assert(string(e.what()) == "Heap is empty! Cannot extract min." && "Test 6 Failed: extractMin exception message incorrect");
+
+    ~PerfCounter() {
+#if LEFTIST_TREE_HAS_PERF_EVENTS
+        if (fd >= 0) close(fd);
+#endif
     }
-    cout << "Test 6 Passed." << endl;
 
-     // Test 7: Merging a tree with itself
-    LeftistTree lt7;
-    lt7.insert(50);
-    lt7.insert(30);
-    lt7.insert(70);
-    lt7.mergeWith(lt7);
+    PerfCounter(const PerfCounter&) = delete;
+    PerfCounter& operator=(const PerfCounter&) = delete;
 
-    assert(lt7.getMin() == 30 && "Test 7 Failed: Merging with self changed min");
-    vector<int> extracted_self_merge;
-    while(!lt7.isEmpty()) {
-        extracted_self_merge.push_back(lt7.extractMin());
+    bool isAvailable() const {
+        return fd >= 0;
     }
-     vector<int> expected_self_merge = {30, 50, 70};
-    assert(extracted_self_merge == expected_self_merge && "Test 7 Failed: Merging with self corrupted tree");
-    cout << "Test 7 Passed." << endl;
 
+    // Zero the count and start counting
+    void start() {
+#if LEFTIST_TREE_HAS_PERF_EVENTS
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    // Stop counting and return the count since start()
+    optional<uint64_t> stop() {
+#if LEFTIST_TREE_HAS_PERF_EVENTS
+        uint64_t value = 0;
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd, &value, sizeof(value)) == static_cast<ssize_t>(sizeof(value))) return value;
+        }
+#endif
+        return nullopt;
+    }
+};
+
+struct HoldModelConfig {
+    size_t queueSize = 100000;
+    IncrementDistribution distribution = IncrementDistribution::Exponential;
+    size_t warmupOps = 0; // Untimed holds first; 0 means one per queued event
+    size_t ops = 1000000;
+    uint64_t seed = 29;
+};
 
-    cout << "All LeftistTree tests passed!" << endl;
+struct HoldModelResult {
+    double nsPerOp;
+    double allocationsPerOp;              // Only calls made through CountingAllocator are seen
+    optional<double> cacheMissesPerOp;    // nullopt without perf counters
+};
+
+using HoldEvent = SimulationEvent<uint32_t>;
+
+// Classic hold model on an EventSimulation over Heap, a heap of HoldEvent:
+// queueSize events, each of which reschedules itself at now + increment when
+// handled, so every operation is one extractMin plus one insert at steady size.
+template <typename Heap>
+HoldModelResult runHoldModel(const HoldModelConfig& config) {
+    EventSimulation<uint32_t, Heap> simulation;
+    HoldIncrement increment(config.distribution, config.seed);
+    for (size_t i = 0; i < config.queueSize; ++i) {
+        simulation.schedule(increment(), static_cast<uint32_t>(i));
+    }
+    auto hold = [&increment](EventSimulation<uint32_t, Heap>& sim, uint32_t id) { sim.schedule(increment(), id); };
+    simulation.run(hold, numeric_limits<double>::infinity(), config.warmupOps ? config.warmupOps : config.queueSize);
+
+    PerfCounter cacheMisses(PerfCounter::CacheMisses);
+    uint64_t allocationsBefore = allocationCounter().allocations;
+    cacheMisses.start();
+    double ms = measureMs([&] { simulation.run(hold, numeric_limits<double>::infinity(), config.ops); });
+    optional<uint64_t> misses = cacheMisses.stop();
+    double ops = static_cast<double>(max<size_t>(config.ops, 1));
+    HoldModelResult result{ms * 1e6 / ops, static_cast<double>(allocationCounter().allocations - allocationsBefore) / ops,
+                           nullopt};
+    if (misses) result.cacheMissesPerOp = static_cast<double>(*misses) / ops;
+    return result;
 }
 
-void runLeftistTreeSample() {
-    LeftistTree lt;
+template <typename Heap>
+void reportHoldModel(const char* heapName, const HoldModelConfig& config) {
+    HoldModelResult result = runHoldModel<Heap>(config);
+    cout << heapName << "," << incrementDistributionName(config.distribution) << "," << config.queueSize << ","
+         << result.nsPerOp << "," << result.allocationsPerOp << ",";
+    if (result.cacheMissesPerOp) {
+        cout << *result.cacheMissesPerOp;
+    } else {
+        cout << "n/a";
+    }
+    cout << endl;
+}
 
-    cout << "Inserting elements: 10, 5, 20, 3, 15, 2" << endl;
-    lt.insert(10);
-    lt.insert(5);
-    lt.insert(20);
-    lt.insert(3);
-    lt.insert(15);
-    lt.insert(2);
+// Hold model over every increment distribution and queue sizes 1e3 up to
+// maxSize, as CSV
+void runHoldModelBenchmark(size_t maxSize) {
+    cout << "heap,distribution,n,ns_per_op,allocs_per_op,cache_misses_per_op" << endl;
+    using Alloc = CountingAllocator<HoldEvent>;
+    for (size_t n = 1000; n <= maxSize; n *= 10) {
+        for (IncrementDistribution distribution :
+             {IncrementDistribution::Exponential, IncrementDistribution::Uniform, IncrementDistribution::Bimodal,
+              IncrementDistribution::Triangular}) {
+            HoldModelConfig config;
+            config.queueSize = n;
+            config.distribution = distribution;
+            reportHoldModel<LeftistTree<HoldEvent, less<HoldEvent>, Alloc>>("leftist", config);
+            reportHoldModel<WeightBiasedLeftistTree<HoldEvent, less<HoldEvent>, Alloc>>("weight-biased", config);
+            reportHoldModel<SkewHeap<HoldEvent, less<HoldEvent>, Alloc>>("skew", config);
+            reportHoldModel<StdPriorityQueueHeap<HoldEvent, less<HoldEvent>, Alloc>>("std::priority_queue", config);
+        }
+    }
+}
 
-    cout << "\nTree structure after insertions:" << endl;
-    lt.printTree();
+enum class KeyDistribution { Random, Ascending, Descending, Duplicates };
 
-    cout << "\nMin element: " << lt.getMin() << endl;
+const char* distributionName(KeyDistribution distribution) {
+    switch (distribution) {
+        case KeyDistribution::Random: return "random";
+        case KeyDistribution::Ascending: return "ascending";
+        case KeyDistribution::Descending: return "descending";
+        case KeyDistribution::Duplicates: return "duplicates";
+    }
+    return "?";
+}
 
-    cout << "\nExtracting min elements:" << endl;
-    while (!lt.isEmpty()) {
-        cout << "Extracted: " << lt.extractMin() << endl;
-        if (!lt.isEmpty()) {
-             cout << "Current Tree Structure:" << endl;
-             lt.printTree();
-             cout << "Next Min: " << lt.getMin() << endl;
-        } else {
-            cout << "Tree is now empty." << endl;
+vector<int> makeKeys(size_t n, KeyDistribution distribution, unsigned seed) {
+    mt19937 rng(seed);
+    vector<int> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        switch (distribution) {
+            case KeyDistribution::Random: keys[i] = static_cast<int>(rng() >> 1); break;
+            case KeyDistribution::Ascending: keys[i] = static_cast<int>(i); break;
+            case KeyDistribution::Descending: keys[i] = static_cast<int>(n - i); break;
+            case KeyDistribution::Duplicates: keys[i] = static_cast<int>(rng() % 16); break;
         }
-        cout << "----" << endl;
     }
+    return keys;
+}
 
-    cout << "\nTesting merge operation:" << endl;
-    LeftistTree lt1, lt2;
-    lt1.insert(10);
-    lt1.insert(20);
-    lt1.insert(5);
-    cout << "Tree 1:" << endl;
-    lt1.printTree();
+// Runs setup (untimed) and run (timed) reps times and returns nanoseconds per
+// operation, with opsPerRun operations per run
+template <typename Setup, typename Run>
+double nsPerOp(size_t reps, size_t opsPerRun, Setup setup, Run run) {
+    double totalMs = 0;
+    for (size_t rep = 0; rep < reps; ++rep) {
+        auto state = setup();
+        totalMs += measureMs([&] { run(*state); });
+    }
+    return totalMs * 1e6 / static_cast<double>(reps * opsPerRun);
+}
 
+// Branchless against branching height-biased merge on the same random keys:
+// ns/op and, where perf counters are available, branch misses per op
+void benchmarkBranchlessMerge() {
+    cout << "Branchless merge (BranchlessLess) vs. branching merge, 1M random keys:" << endl;
+    vector<int> keys = makeKeys(1000000, KeyDistribution::Random, 30);
+    auto run = [&](auto heap, const char* name) {
+        using Heap = decltype(heap);
+        PerfCounter branchMisses(PerfCounter::BranchMisses);
+        auto measure = [&](const char* op, auto&& body) {
+            branchMisses.start();
+            double ns = measureMs(body) * 1e6 / static_cast<double>(keys.size());
+            optional<uint64_t> misses = branchMisses.stop();
+            cout << "  " << name << " " << op << " " << ns << " ns/op";
+            if (misses) cout << ", " << static_cast<double>(*misses) / static_cast<double>(keys.size()) << " branch misses/op";
+            cout << endl;
+        };
+        Heap filled;
+        measure("insert", [&] { for (int key : keys) filled.insert(key); });
+        measure("hold", [&] {
+            mt19937 rng(3);
+            for (size_t i = 0; i < keys.size(); ++i) filled.insert(filled.extractMin() + static_cast<int>(rng() % 1024));
+        });
+        measure("extractMin", [&] {
+            long long sum = 0;
+            while (!filled.isEmpty()) sum += filled.extractMin();
+            benchmarkSink = sum;
+        });
+    };
+    run(LeftistTree<int, BranchlessLess<int>>(), "branchless");
+    run(LeftistTree<int>(), "branching");
+}
 
-    lt2.insert(15);
-    lt2.insert(8);
-    lt2.insert(25);
-    cout << "\nTree 2:" << endl;
-    lt2.printTree();
+template <typename Heap>
+void benchmarkHeapOperations(const char* heapName, size_t n, KeyDistribution distribution) {
+    vector<int> keys = makeKeys(n, distribution, static_cast<unsigned>(n));
+    auto empty = [] { return make_unique<Heap>(); };
+    auto filled = [&] { return make_unique<Heap>(keys.begin(), keys.end()); };
+    // Enough repetitions to cover about a million elements per measurement
+    size_t reps = max<size_t>(1, 1000000 / n);
+    auto report = [&](const char* op, double ns) {
+        cout << op << "," << heapName << "," << distributionName(distribution) << "," << n << "," << ns << endl;
+    };
 
-    lt1.mergeWith(lt2);
-    cout << "\nTree 1 after merging with Tree 2:" << endl;
-    lt1.printTree();
+    report("insert", nsPerOp(reps, n, empty, [&](Heap& heap) {
+        for (int key : keys) heap.insert(key);
+    }));
+    report("extractMin", nsPerOp(reps, n, filled, [&](Heap& heap) {
+        long long sum = 0;
+        while (!heap.isEmpty()) sum += heap.extractMin();
+        benchmarkSink = sum;
+    }));
+    report("getMin", nsPerOp(reps, n, filled, [&](Heap& heap) {
+        for (size_t i = 0; i < n; ++i) benchmarkSink = heap.getMin(); // volatile store per call
+    }));
+    report("heapify", nsPerOp(reps, n, [] { return make_unique<int>(0); }, [&](int&) {
+        Heap heap(keys.begin(), keys.end());
+        benchmarkSink = heap.getMin();
+    }));
 
-    cout << "\nTree 2 after being merged (should be empty):" << endl;
-    lt2.printTree();
+    // Melds of two halves (equal) and of a full heap with a 64-element one (skewed)
+    auto halves = [&] {
+        auto heaps = make_unique<pair<Heap, Heap>>();
+        for (size_t i = 0; i < n; ++i) (i % 2 ? heaps->first : heaps->second).insert(keys[i]);
+        return heaps;
+    };
+    auto skewed = [&] {
+        auto heaps = make_unique<pair<Heap, Heap>>();
+        for (size_t i = 0; i < n; ++i) (i < 64 ? heaps->second : heaps->first).insert(keys[i]);
+        return heaps;
+    };
+    auto meld = [](pair<Heap, Heap>& heaps) {
+        heaps.first.mergeWith(heaps.second);
+        benchmarkSink = heaps.first.getMin();
+    };
+    if (n >= 128) {
+        report("mergeWith-equal", nsPerOp(reps, 1, halves, meld));
+        report("mergeWith-skewed", nsPerOp(reps, 1, skewed, meld));
+    }
 
-    cout << "\nExtracting from merged tree:" << endl;
-     while (!lt1.isEmpty()) {
-        cout << "Extracted: " << lt1.extractMin() << endl;
+    // Hold model at fixed size n: extractMin, then insert min + random increment
+    report("hold", nsPerOp(reps, n, filled, [&](Heap& heap) {
+        mt19937 rng(3);
+        for (size_t i = 0; i < n; ++i) {
+            int minKey = heap.extractMin();
+            heap.insert(minKey + static_cast<int>(rng() % 1024));
+        }
+        benchmarkSink = heap.getMin();
+    }));
+    if constexpr (requires(Heap& heap) { heap.replaceTop(0); }) {
+        report("hold-replaceTop", nsPerOp(reps, n, filled, [&](Heap& heap) {
+            mt19937 rng(3);
+            for (size_t i = 0; i < n; ++i) {
+                heap.replaceTop(heap.getMin() + static_cast<int>(rng() % 1024));
+            }
+            benchmarkSink = heap.getMin();
+        }));
     }
+}
 
+// The regression suite: every operation, for each size from 1e3 up to maxSize
+// and each key distribution, on LeftistTree (with the branching and the
+// branchless merge), std::priority_queue and a pairing heap. Prints CSV
+// (op,heap,distribution,n,ns_per_op) for diffing between builds.
+void runBenchmarkSuite(size_t maxSize) {
+    cout << "op,heap,distribution,n,ns_per_op" << endl;
+    for (size_t n = 1000; n <= maxSize; n *= 10) {
+        for (KeyDistribution distribution : {KeyDistribution::Random, KeyDistribution::Ascending,
+                                             KeyDistribution::Descending, KeyDistribution::Duplicates}) {
+            benchmarkHeapOperations<LeftistTree<int>>("leftist", n, distribution);
+            benchmarkHeapOperations<LeftistTree<int, BranchlessLess<int>>>("leftist-branchless", n, distribution);
+            benchmarkHeapOperations<StdPriorityQueueHeap<int>>("std::priority_queue", n, distribution);
+            benchmarkHeapOperations<PairingHeap<int>>("pairing", n, distribution);
+        }
+    }
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    // "bench suite [maxSize]" runs the regression suite, "bench hold [maxSize]"
+    // the hold model, plain "bench" the feature benchmarks; all replace the tests
+    // and the sample
+    if (argc > 2 && string(argv[1]) == "bench" && string(argv[2]) == "suite") {
+        runBenchmarkSuite(argc > 3 ? static_cast<size_t>(stod(argv[3])) : 1000000);
+        return 0;
+    }
+    if (argc > 2 && string(argv[1]) == "bench" && string(argv[2]) == "hold") {
+        runHoldModelBenchmark(argc > 3 ? static_cast<size_t>(stod(argv[3])) : 1000000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "bench") {
+        benchmarkHeapify();
+        benchmarkLazyMerge();
+        benchmarkCompactLayout();
+        benchmarkConcurrent();
+        benchmarkSharded();
+        benchmarkMeldAll();
+        benchmarkRestart();
+        benchmarkSortedDrain();
+        benchmarkKWayMerge();
+        benchmarkBalancePolicies();
+        benchmarkPersistent();
+        benchmarkInsertBatch();
+        benchmarkCompact();
+        benchmarkTopK();
+        benchmarkTimerQueue();
+        benchmarkBranchlessMerge();
+        if constexpr (LEFTIST_TREE_STATS) leftistTreeStats().print(cout);
+        return 0;
+    }
     testLeftistTree();
+    testBaselineHeaps();
     runLeftistTreeSample();
     return 0;
 }
\ No newline at end of file